@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Pointer that stores the distance from its own address to the target.
+// Objects linked with `OffsetPtr`-s stay valid when the whole region they live in is
+// mapped at a different address, e.g. by another process or after a restart.
+//
+// Offset 1 encodes null, so an `OffsetPtr` can't point one byte past itself.
+template <typename T>
+class OffsetPtr {
+    template <typename Y>
+    friend class OffsetPtr;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    OffsetPtr() : offset_(kNull) {
+    }
+    OffsetPtr(std::nullptr_t) : OffsetPtr() {
+    }
+    OffsetPtr(T* ptr) {
+        Set(ptr);
+    }
+
+    // Copies are rebased, both pointers point to the same object afterwards
+    OffsetPtr(const OffsetPtr& other) {
+        Set(other.Get());
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    OffsetPtr(const OffsetPtr<U>& other) {
+        Set(static_cast<T*>(other.Get()));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    OffsetPtr& operator=(const OffsetPtr& other) {
+        Set(other.Get());
+        return *this;
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    OffsetPtr& operator=(const OffsetPtr<U>& other) {
+        Set(static_cast<T*>(other.Get()));
+        return *this;
+    }
+    OffsetPtr& operator=(T* ptr) {
+        Set(ptr);
+        return *this;
+    }
+    OffsetPtr& operator=(std::nullptr_t) {
+        offset_ = kNull;
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Swap(OffsetPtr& other) {
+        T* mine = Get();
+        Set(other.Get());
+        other.Set(mine);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        if (offset_ == kNull) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + offset_);
+    }
+    template <typename U = T, typename = std::enable_if_t<!std::is_void<U>::value>>
+    U& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    explicit operator bool() const {
+        return offset_ != kNull;
+    }
+
+private:
+    static constexpr intptr_t kNull = 1;
+
+    void Set(T* ptr) {
+        if (ptr == nullptr) {
+            offset_ = kNull;
+        } else {
+            offset_ = reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this);
+        }
+    }
+
+    intptr_t offset_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const OffsetPtr<T>& left, const OffsetPtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const OffsetPtr<T>& left, const OffsetPtr<U>& right) {
+    return !(left == right);
+}
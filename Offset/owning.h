@@ -0,0 +1,270 @@
+#pragma once
+
+#include "../Unique/compressed_pair.h"
+#include "../counters.h"
+#include "../intrusive.h"
+#include "offset_ptr.h"
+#include "segment.h"
+
+#include <atomic>
+#include <cstddef>  // std::nullptr_t
+#include <utility>
+
+// Owning pointers for objects allocated inside a `Segment`. Both hold an `OffsetPtr`,
+// so an object graph built from them can be remapped and used as is.
+
+// Destroys an object and returns its memory to the segment it was allocated from.
+// Works both as a `UniquePtr`-style deleter and as a `RefCounted` deleter.
+struct SegmentDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        if (object) {
+            object->~T();
+            Segment::Deallocate(object);
+        }
+    }
+
+    template <typename T>
+    void operator()(T* object) const {
+        Destroy(object);
+    }
+};
+
+// Reference counted base for objects living in a segment, the counter is part of the object.
+// It is atomic (and lock-free, so it works across processes): any process may take and drop
+// references. Dropping the last one frees segment memory, which falls under the segment's
+// one-allocating-process rule.
+template <typename Derived>
+using SegmentRefCounted = RefCounted<Derived, AtomicCounter, SegmentDelete>;
+
+static_assert(std::atomic<size_t>::is_always_lock_free);
+
+template <typename T, typename Deleter = SegmentDelete>
+class OffsetUniquePtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit OffsetUniquePtr(T* ptr = nullptr) {
+        object_.GetFirst() = ptr;
+    }
+    OffsetUniquePtr(T* ptr, Deleter deleter) {
+        object_.GetFirst() = ptr;
+        object_.GetSecond() = std::move(deleter);
+    }
+
+    OffsetUniquePtr(const OffsetUniquePtr& other) = delete;
+    OffsetUniquePtr& operator=(const OffsetUniquePtr& other) = delete;
+
+    OffsetUniquePtr(OffsetUniquePtr&& other) noexcept {
+        object_.GetFirst() = other.Release();
+        object_.GetSecond() = std::move(other.GetDeleter());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    OffsetUniquePtr& operator=(OffsetUniquePtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Reset(other.Release());
+        object_.GetSecond() = std::move(other.GetDeleter());
+        return *this;
+    }
+    OffsetUniquePtr& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~OffsetUniquePtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    T* Release() {
+        T* obj = Get();
+        object_.GetFirst() = nullptr;
+        return obj;
+    }
+    void Reset(T* ptr = nullptr) {
+        T* old = Get();
+        object_.GetFirst() = ptr;
+        if (old) {
+            object_.GetSecond()(old);
+        }
+    }
+    void Swap(OffsetUniquePtr& other) {
+        object_.GetFirst().Swap(other.object_.GetFirst());
+        std::swap(object_.GetSecond(), other.object_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return object_.GetFirst().Get();
+    }
+    Deleter& GetDeleter() {
+        return object_.GetSecond();
+    }
+    const Deleter& GetDeleter() const {
+        return object_.GetSecond();
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+
+private:
+    CompressedPair<OffsetPtr<T>, Deleter> object_;
+};
+
+// `IntrusivePtr` for segment objects, `T` is expected to derive from `SegmentRefCounted<T>`.
+template <typename T>
+class OffsetIntrusivePtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    OffsetIntrusivePtr() = default;
+    OffsetIntrusivePtr(std::nullptr_t) : OffsetIntrusivePtr() {
+    }
+    OffsetIntrusivePtr(T* ptr) : ptr_(ptr) {
+        if (ptr) {
+            ptr->IncRef();
+        }
+    }
+
+    OffsetIntrusivePtr(const OffsetIntrusivePtr& other) : ptr_(other.ptr_) {
+        if (T* ptr = Get()) {
+            ptr->IncRef();
+        }
+    }
+    OffsetIntrusivePtr(OffsetIntrusivePtr&& other) : ptr_(other.ptr_) {
+        other.ptr_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    OffsetIntrusivePtr& operator=(const OffsetIntrusivePtr& other) {
+        Reset(other.Get());
+        return *this;
+    }
+    OffsetIntrusivePtr& operator=(OffsetIntrusivePtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        ptr_ = other.ptr_;
+        other.ptr_ = nullptr;
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~OffsetIntrusivePtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (T* ptr = Get()) {
+            ptr_ = nullptr;
+            ptr->DecRef();
+        }
+    }
+    void Reset(T* ptr) {
+        if (ptr) {
+            ptr->IncRef();
+        }
+        Reset();
+        ptr_ = ptr;
+    }
+    void Swap(OffsetIntrusivePtr& other) {
+        ptr_.Swap(other.ptr_);
+    }
+
+    // Gives up the pointer but not the reference, e.g. to leave an owning root in a segment:
+    //     segment->SetRoot(root.Detach());
+    T* Detach() {
+        T* ptr = Get();
+        ptr_ = nullptr;
+        return ptr;
+    }
+    // Takes over a reference given up by `Detach`, possibly in another process:
+    //     auto root = OffsetIntrusivePtr<T>::Adopt(static_cast<T*>(segment->GetRoot()));
+    //     segment->SetRoot(nullptr);
+    static OffsetIntrusivePtr Adopt(T* ptr) {
+        OffsetIntrusivePtr res;
+        res.ptr_ = ptr;
+        return res;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_.Get();
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    size_t UseCount() const {
+        if (T* ptr = Get()) {
+            return ptr->RefCount();
+        }
+        return 0;
+    }
+    explicit operator bool() const {
+        return static_cast<bool>(ptr_);
+    }
+
+private:
+    OffsetPtr<T> ptr_;
+};
+
+template <typename T, typename... Args>
+OffsetUniquePtr<T> MakeOffsetUnique(Segment* segment, Args&&... args) {
+    static_assert(alignof(T) <= 16, "Segment blocks are 16-byte aligned");
+    void* memory = segment->Allocate(sizeof(T));
+    T* raw;
+    try {
+        raw = ::new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+        Segment::Deallocate(memory);
+        throw;
+    }
+    return OffsetUniquePtr<T>(raw);
+}
+
+template <typename T, typename... Args>
+OffsetIntrusivePtr<T> MakeOffsetIntrusive(Segment* segment, Args&&... args) {
+    static_assert(alignof(T) <= 16, "Segment blocks are 16-byte aligned");
+    void* memory = segment->Allocate(sizeof(T));
+    T* raw;
+    try {
+        raw = ::new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+        Segment::Deallocate(memory);
+        throw;
+    }
+    return OffsetIntrusivePtr<T>(raw);
+}
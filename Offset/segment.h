@@ -0,0 +1,253 @@
+#pragma once
+
+#include "offset_ptr.h"
+
+#include <algorithm>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <new>  // std::bad_alloc
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Allocator living inside a memory region, e.g. a mapped file or a shared memory object.
+// `Segment` is the header at the very start of the region and keeps nothing but offsets,
+// so the region stays consistent wherever it is mapped. Every allocation is prefixed
+// with a small block header that remembers where its segment starts, so
+// `Segment::Deallocate` needs nothing but the pointer.
+//
+// Freed blocks go to a first-fit free list; neighbours are not coalesced.
+// The segment does no locking: only one process at a time may allocate from it.
+class Segment {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    // Builds an empty segment over `size` bytes at `memory` (16-byte aligned).
+    // Returns nullptr if `size` can't hold the segment header.
+    static Segment* Format(void* memory, size_t size) {
+        if (size < RoundUp(sizeof(Segment))) {
+            return nullptr;
+        }
+        Segment* segment = ::new (memory) Segment();
+        segment->size_ = size;
+        segment->top_ = RoundUp(sizeof(Segment));
+        segment->free_head_ = 0;
+        return segment;
+    }
+
+    // Reuses a segment built by `Format` over `size` bytes, possibly mapped at another address.
+    // Returns nullptr if the region doesn't hold a segment of exactly that size.
+    static Segment* Attach(void* memory, size_t size) {
+        if (size < sizeof(Segment)) {
+            return nullptr;
+        }
+        Segment* segment = static_cast<Segment*>(memory);
+        if (segment->magic_ != kMagic || segment->size_ != size || segment->top_ > size) {
+            return nullptr;
+        }
+        return segment;
+    }
+
+    Segment(const Segment& other) = delete;
+    Segment& operator=(const Segment& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Allocation
+
+    void* Allocate(size_t bytes) {
+        // Also rules out overflow below
+        if (bytes > size_) {
+            throw std::bad_alloc{};
+        }
+        // A freed block keeps its free-list link in the payload, so every block has room for it
+        uint64_t need = RoundUp(std::max<uint64_t>(bytes, sizeof(uint64_t)) + sizeof(BlockHeader));
+        // First fit from the free list
+        uint64_t* link = &free_head_;
+        while (*link != 0) {
+            BlockHeader* block = BlockAt(*link);
+            if (block->size >= need) {
+                *link = NextFree(block);
+                return block + 1;
+            }
+            link = &NextFree(block);
+        }
+        if (need > size_ - top_) {
+            throw std::bad_alloc{};
+        }
+        BlockHeader* block = BlockAt(top_);
+        block->size = need;
+        block->segment_offset = top_;
+        top_ += need;
+        return block + 1;
+    }
+
+    static void Deallocate(void* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        BlockHeader* block = static_cast<BlockHeader*>(ptr) - 1;
+        Segment* segment = reinterpret_cast<Segment*>(reinterpret_cast<char*>(block) -
+                                                      block->segment_offset);
+        NextFree(block) = segment->free_head_;
+        segment->free_head_ = block->segment_offset;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Root object
+
+    // Entry point to the object graph, survives remapping. The segment doesn't own the root:
+    // to keep it alive with no process attached, store a reference given up by
+    // `OffsetIntrusivePtr::Detach` and take it back with `OffsetIntrusivePtr::Adopt`.
+    void SetRoot(void* root) {
+        root_ = root;
+    }
+    void* GetRoot() const {
+        return root_.Get();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return size_;
+    }
+    // Bytes never handed out yet, freed blocks are not counted.
+    size_t Available() const {
+        return size_ - top_;
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x53454731'4f464653;
+
+    struct alignas(16) BlockHeader {
+        uint64_t size;
+        // Distance back to the segment header
+        uint64_t segment_offset;
+    };
+
+    Segment() : magic_(kMagic) {
+    }
+
+    static uint64_t RoundUp(uint64_t bytes) {
+        return (bytes + 15) & ~uint64_t{15};
+    }
+
+    BlockHeader* BlockAt(uint64_t offset) {
+        return reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    // A freed block keeps the next free offset in its payload.
+    static uint64_t& NextFree(BlockHeader* block) {
+        return *reinterpret_cast<uint64_t*>(block + 1);
+    }
+
+    uint64_t magic_;
+    uint64_t size_;
+    uint64_t top_;
+    uint64_t free_head_;
+    OffsetPtr<void> root_;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// File (or POSIX shared memory object) mapped read-write and shared between processes.
+// Open the same path again to remap an existing segment instead of rebuilding it.
+class MappedRegion {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    MappedRegion() = default;
+
+    MappedRegion(const MappedRegion& other) = delete;
+    MappedRegion& operator=(const MappedRegion& other) = delete;
+
+    // Opens or creates the file at `path` and maps `size` bytes of it.
+    static MappedRegion OpenFile(const char* path, size_t size) {
+        return Map(::open(path, O_RDWR | O_CREAT, 0600), size);
+    }
+    // Same for a POSIX shared memory object, `name` starts with '/'.
+    static MappedRegion OpenShm(const char* name, size_t size) {
+        return Map(::shm_open(name, O_RDWR | O_CREAT, 0600), size);
+    }
+
+    MappedRegion(MappedRegion&& other) : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    MappedRegion& operator=(MappedRegion&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~MappedRegion() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    void* Data() const {
+        return data_;
+    }
+    size_t Size() const {
+        return size_;
+    }
+    explicit operator bool() const {
+        return data_ != nullptr;
+    }
+
+private:
+    // Takes ownership of `fd`, returns an empty region on failure.
+    static MappedRegion Map(int fd, size_t size) {
+        MappedRegion res;
+        if (fd < 0) {
+            return res;
+        }
+        // A file shorter than the mapping would fault on access past its end
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size &&
+                                      ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+            ::close(fd);
+            return res;
+        }
+        void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data != MAP_FAILED) {
+            res.data_ = data;
+            res.size_ = size;
+        }
+        return res;
+    }
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
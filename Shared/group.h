@@ -0,0 +1,94 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>  // size_t
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Control block followed by `count` objects in the same allocation.
+// All objects share one strong counter and are destroyed together.
+template <typename T>
+struct ControlBlockGroup : ControlBlockBase {
+    size_t count;
+
+    static constexpr size_t kAlignment =
+        alignof(T) > alignof(ControlBlockBase) ? alignof(T) : alignof(ControlBlockBase);
+    // Objects start right after the block, rounded up to `alignof(T)`
+    static constexpr size_t kObjectsOffset =
+        (sizeof(ControlBlockGroup) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    template <typename... Args>
+    static ControlBlockGroup* Create(size_t count, const Args&... args) {
+        if (count > (std::numeric_limits<size_t>::max() - kObjectsOffset) / sizeof(T)) {
+            throw std::bad_array_new_length{};
+        }
+        void* memory = ::operator new(kObjectsOffset + count * sizeof(T),
+                                      std::align_val_t(kAlignment));
+        ControlBlockGroup* block = ::new (memory) ControlBlockGroup(count);
+        T* objects = block->Objects();
+        size_t built = 0;
+        try {
+            for (; built < count; ++built) {
+                ::new (static_cast<void*>(objects + built)) T(args...);
+            }
+        } catch (...) {
+            block->count = built;
+            block->DestroyObject();
+            block->DeleteBlock();
+            throw;
+        }
+        return block;
+    }
+
+    T* Objects() noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(this) + kObjectsOffset);
+    }
+
+    void* GetObj() noexcept override {
+        return reinterpret_cast<void*>(Objects());
+    }
+
+    void DestroyObject() noexcept override {
+        T* objects = Objects();
+        for (size_t i = count; i > 0; --i) {
+            objects[i - 1].~T();
+        }
+    }
+
+    void DeleteBlock() noexcept override {
+        this->~ControlBlockGroup();
+        ::operator delete(static_cast<void*>(this), std::align_val_t(kAlignment));
+    }
+
+private:
+    explicit ControlBlockGroup(size_t n) : count(n) {
+    }
+};
+
+// Builds `count` objects from the same `args` with one allocation and one control block.
+// Each returned pointer is an alias of the group: the objects stay alive while any
+// of them (or a copy, or a locked `WeakPtr`) is alive.
+template <typename T, typename... Args>
+std::vector<SharedPtr<T>> MakeSharedGroup(size_t count, const Args&... args) {
+    static_assert(!std::is_convertible_v<T*, EnableSharedFromThisBase*>,
+                  "SharedFromThis of a group member would alias the first object");
+    static_assert(!kSharesFromBlock<T>, "Group members are not in a ControlBlockInplace");
+    std::vector<SharedPtr<T>> res;
+    if (count == 0) {
+        return res;
+    }
+    res.reserve(count);
+
+    SharedPtr<T> group;
+    ControlBlockGroup<T>* block = ControlBlockGroup<T>::Create(count, args...);
+    group.block_ = block;
+    group.ptr_ = block->Objects();
+    for (size_t i = 0; i < count; ++i) {
+        res.emplace_back(group, group.ptr_ + i);
+    }
+    return res;
+}
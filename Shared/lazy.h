@@ -0,0 +1,104 @@
+#pragma once
+
+#include "../core.h"
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+// Thrown when the factory of a `LazyShared` returns an empty pointer
+class LazyFactoryError : public std::exception {};
+
+// Shared resource built by `factory` on first use. Once it is published, `Get()` and
+// `Share()` are a single acquire load (plus an atomic increment for `Share()`); only
+// the first callers (and callers right after a `Reset()`) take the mutex, and the factory
+// runs exactly once per generation.
+//
+// `Reset()` drops the current object so the next access builds a fresh one. Readers may
+// still use the old one, so it is retired rather than released: every object built stays
+// alive until the `LazyShared` itself is destroyed. A reference from `Get()` is valid
+// for that long; a `Share()` pointer may outlive it. Resetting often thus costs memory,
+// use an `AtomicSharedPtr` with your own synchronization if objects have to go away.
+template <typename T>
+class LazyShared {
+public:
+    using Factory = std::function<AtomicSharedPtr<T>()>;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    LazyShared() : LazyShared([] { return MakeAtomicShared<T>(); }) {
+    }
+    explicit LazyShared(Factory factory) : factory_(std::move(factory)) {
+    }
+
+    LazyShared(const LazyShared& other) = delete;
+    LazyShared& operator=(const LazyShared& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Access
+
+    T& Get() {
+        return *Current();
+    }
+    T& operator*() {
+        return Get();
+    }
+    T* operator->() {
+        return &Get();
+    }
+
+    // Owning pointer to the current object, may be copied and dropped on any thread.
+    AtomicSharedPtr<T> Share() {
+        return Current();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        current_.store(nullptr, std::memory_order_release);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    bool IsBuilt() const {
+        return current_.load(std::memory_order_acquire) != nullptr;
+    }
+
+private:
+    // Published owners are never modified or dropped before the destructor, so readers
+    // may use one without the mutex.
+    const AtomicSharedPtr<T>& Current() {
+        const AtomicSharedPtr<T>* owner = current_.load(std::memory_order_acquire);
+        if (owner != nullptr) {
+            return *owner;
+        }
+        return Build();
+    }
+    const AtomicSharedPtr<T>& Build() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        const AtomicSharedPtr<T>* owner = current_.load(std::memory_order_relaxed);
+        if (owner == nullptr) {
+            AtomicSharedPtr<T> obj = factory_();
+            if (!obj) {
+                throw LazyFactoryError{};
+            }
+            owners_.push_back(std::move(obj));
+            owner = &owners_.back();
+            current_.store(owner, std::memory_order_release);
+        }
+        return *owner;
+    }
+
+    std::atomic<const AtomicSharedPtr<T>*> current_{nullptr};
+    std::mutex mutex_;
+    Factory factory_;
+    // Current object and all retired ones; a deque never moves its elements
+    std::deque<AtomicSharedPtr<T>> owners_;
+};
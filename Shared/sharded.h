@@ -0,0 +1,260 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // std::nullptr_t, size_t
+#include <utility>
+
+// Shared pointer for a few very hot objects (current config, logger, ...) that every
+// thread copies and drops at once. A single counter would bounce its cache line between
+// all cores, so the strong count is split into per-thread-group shards, each on its own
+// line. A copy increments the shard of the copying thread and remembers it; the drop
+// decrements that same shard.
+//
+// Zero detection is a two-level SNZI (scalable non-zero indicator): shards are grouped,
+// a group counts its non-zero shards and `active` counts the non-zero groups. A node
+// announces itself to its parent before leaving zero and withdraws after returning to it,
+// so `active` only reaches zero once no pointer is left anywhere, and the object is
+// destroyed by the drop of its last pointer. A shard flipping between 0 and 1 touches
+// only its group's line while another shard of the group is in use; `active` changes only
+// when a whole group starts or stops using the object.
+//
+// Counters are atomic, unlike `ControlBlockBase`. Every block takes
+// `kRefShards` cache lines, so use this for a handful of contended objects only.
+// There is no `WeakPtr` for sharded blocks.
+
+inline constexpr size_t kRefShards = 16;
+
+// Shard used by the calling thread, threads are spread round-robin.
+inline size_t CurrentRefShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kRefShards;
+    return shard;
+}
+
+inline constexpr size_t kRefShardsPerGroup = 4;
+inline constexpr size_t kRefShardGroups = kRefShards / kRefShardsPerGroup;
+
+struct ShardedControlBlockBase {
+    // A shard counts references, a group its non-zero shards
+    struct alignas(64) Counter {
+        std::atomic<size_t> count{0};
+    };
+
+    Counter shards[kRefShards];
+    Counter groups[kRefShardGroups];
+    // Non-zero groups
+    alignas(64) std::atomic<size_t> active{0};
+
+    ShardedControlBlockBase() = default;
+
+    // The caller must already own a reference, or be creating the first one.
+    void IncStr(size_t shard) {
+        Arrive(shards[shard].count, [this, shard] { ArriveGroup(shard / kRefShardsPerGroup); },
+               [this, shard] { DepartGroup(shard / kRefShardsPerGroup); });
+    }
+
+    void DecStr(size_t shard) {
+        if (shards[shard].count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DepartGroup(shard / kRefShardsPerGroup);
+        }
+    }
+
+    // Sum of all shards, exact only while nobody copies or drops pointers.
+    size_t UseCount() const {
+        size_t res = 0;
+        for (const Counter& shard : shards) {
+            res += shard.count.load(std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    virtual void* GetObj() noexcept = 0;
+
+    virtual void DestroyAndDelete() noexcept = 0;
+
+    virtual ~ShardedControlBlockBase() = default;
+
+private:
+    // Increments `count`, announcing it to the parent with `up` before it leaves zero.
+    // If another thread wins the 0 -> 1 race, `down` takes the announcement back; that can't
+    // drop `active` to zero, as the caller's own reference keeps its nodes non-zero.
+    template <typename Up, typename Down>
+    static void Arrive(std::atomic<size_t>& count, Up up, Down down) {
+        size_t cur = count.load(std::memory_order_relaxed);
+        while (true) {
+            if (cur == 0) {
+                up();
+                if (count.compare_exchange_strong(cur, 1, std::memory_order_relaxed)) {
+                    return;
+                }
+                down();
+            } else if (count.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    void ArriveGroup(size_t group) {
+        Arrive(groups[group].count, [this] { active.fetch_add(1, std::memory_order_relaxed); },
+               [this] { DepartRoot(); });
+    }
+    void DepartGroup(size_t group) {
+        if (groups[group].count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DepartRoot();
+        }
+    }
+    void DepartRoot() {
+        if (active.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DestroyAndDelete();
+        }
+    }
+};
+
+template <typename T>
+struct ShardedControlBlock : ShardedControlBlockBase {
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    template <typename... Args>
+    explicit ShardedControlBlock(Args&&... args) {
+        ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    void* GetObj() noexcept override {
+        return reinterpret_cast<void*>(storage);
+    }
+
+    void DestroyAndDelete() noexcept override {
+        reinterpret_cast<T*>(GetObj())->~T();
+        delete this;
+    }
+};
+
+template <typename T>
+class ShardedSharedPtr {
+    template <typename Y>
+    friend class ShardedSharedPtr;
+
+    template <typename Y, typename... Args>
+    friend ShardedSharedPtr<Y> MakeShardedShared(Args&&... args);
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ShardedSharedPtr() : ptr_(nullptr), block_(nullptr), shard_(0) {
+    }
+    ShardedSharedPtr(std::nullptr_t) : ShardedSharedPtr() {
+    }
+
+    ShardedSharedPtr(const ShardedSharedPtr& other)
+        : ptr_(other.ptr_), block_(other.block_), shard_(CurrentRefShard()) {
+        if (block_ != nullptr) {
+            block_->IncStr(shard_);
+        }
+    }
+    template <typename U>
+    ShardedSharedPtr(const ShardedSharedPtr<U>& other)
+        : ptr_(other.ptr_), block_(other.block_), shard_(CurrentRefShard()) {
+        if (block_ != nullptr) {
+            block_->IncStr(shard_);
+        }
+    }
+
+    // A moved pointer keeps its shard
+    ShardedSharedPtr(ShardedSharedPtr&& other)
+        : ptr_(other.ptr_), block_(other.block_), shard_(other.shard_) {
+        other.ptr_ = nullptr;
+        other.block_ = nullptr;
+    }
+    template <typename U>
+    ShardedSharedPtr(ShardedSharedPtr<U>&& other)
+        : ptr_(other.ptr_), block_(other.block_), shard_(other.shard_) {
+        other.ptr_ = nullptr;
+        other.block_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ShardedSharedPtr& operator=(const ShardedSharedPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        ShardedSharedPtr copy(other);
+        Swap(copy);
+        return *this;
+    }
+    ShardedSharedPtr& operator=(ShardedSharedPtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        Swap(other);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~ShardedSharedPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (block_ != nullptr) {
+            block_->DecStr(shard_);
+            ptr_ = nullptr;
+            block_ = nullptr;
+        }
+    }
+    void Swap(ShardedSharedPtr& other) {
+        std::swap(ptr_, other.ptr_);
+        std::swap(block_, other.block_);
+        std::swap(shard_, other.shard_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_;
+    }
+    T& operator*() const {
+        return *ptr_;
+    }
+    T* operator->() const {
+        return ptr_;
+    }
+    size_t UseCount() const {
+        if (block_ == nullptr) {
+            return 0;
+        }
+        return block_->UseCount();
+    }
+    explicit operator bool() const {
+        return ptr_;
+    }
+
+private:
+    T* ptr_;
+    ShardedControlBlockBase* block_;
+    size_t shard_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ShardedSharedPtr<T>& left, const ShardedSharedPtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+ShardedSharedPtr<T> MakeShardedShared(Args&&... args) {
+    ShardedSharedPtr<T> res;
+    res.block_ = new ShardedControlBlock<T>(std::forward<Args>(args)...);
+    res.ptr_ = reinterpret_cast<T*>(res.block_->GetObj());
+    res.shard_ = CurrentRefShard();
+    res.block_->IncStr(res.shard_);
+    return res;
+}
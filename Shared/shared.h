@@ -1,8 +1,10 @@
 #pragma once
 
+#include "../profiler.h"
 #include "sw_fwd.h"  // Forward declaration
 
-#include <cstddef>  // std::nullptr_t
+#include <cstddef>  // std::nullptr_t, offsetof
+#include <type_traits>
 #include <utility>
 
 struct ControlBlockBase {
@@ -27,6 +29,22 @@ struct ControlBlockBase {
         --weak;
     }
 
+    // Drops a strong reference. The last one destroys the object and then gives up the weak
+    // reference held on behalf of all strong owners.
+    void ReleaseStrong() noexcept {
+        if (--strong == 0) {
+            DestroyObject();
+            ReleaseWeak();
+        }
+    }
+
+    // Drops a weak reference, deleting the block with the last one
+    void ReleaseWeak() noexcept {
+        if (--weak == 0) {
+            DeleteBlock();
+        }
+    }
+
     virtual void* GetObj() noexcept = 0;
 
     virtual void DestroyObject() noexcept = 0;
@@ -45,6 +63,7 @@ struct ControlBlockPtr : ControlBlockBase {
 
     void DestroyObject() noexcept override {
         if (ptr) {
+            SMART_POINTERS_PROFILE_FREE(ptr);
             delete ptr;
         }
         ptr = nullptr;
@@ -72,8 +91,52 @@ struct ControlBlockInplace : ControlBlockBase {
         return reinterpret_cast<void*>(storage);
     }
 
+    // Inverse of `GetObj()`. `storage` follows the vtable pointer, which makes the block
+    // non-standard-layout, but its offset is still fixed for a given `T`.
+    static ControlBlockInplace* FromObject(const T* obj) noexcept {
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+#endif
+        constexpr size_t kStorageOffset = offsetof(ControlBlockInplace, storage);
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+        auto* bytes = reinterpret_cast<unsigned char*>(const_cast<T*>(obj));
+        return reinterpret_cast<ControlBlockInplace*>(bytes - kStorageOffset);
+    }
+
+    void DestroyObject() noexcept override {
+        T* obj = reinterpret_cast<T*>(GetObj());
+        SMART_POINTERS_PROFILE_FREE(obj);
+        obj->~T();
+    }
+
+    void DeleteBlock() noexcept override {
+        delete this;
+    }
+};
+
+// `ControlBlockInplace` with the object starting on a new cache line, so that the counters
+// and the object's data never share one, and nothing else is allocated next to the object.
+template <typename T>
+struct ControlBlockInplacePadded : ControlBlockBase {
+    static constexpr size_t kAlignment = alignof(T) > 64 ? alignof(T) : 64;
+
+    alignas(kAlignment) unsigned char storage[sizeof(T)];
+
+    template <typename... Args>
+    explicit ControlBlockInplacePadded(Args&&... args) {
+        ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    void* GetObj() noexcept override {
+        return reinterpret_cast<void*>(storage);
+    }
+
     void DestroyObject() noexcept override {
         T* obj = reinterpret_cast<T*>(GetObj());
+        SMART_POINTERS_PROFILE_FREE(obj);
         obj->~T();
     }
 
@@ -130,6 +193,81 @@ public:
         }
     }
 };
+
+class EnableSharedFromThisInplaceBase {};
+
+// Passkey of `EnableSharedFromThisInplace`, only `MakeShared` can make one
+class InplaceKey {
+    template <typename T, typename... Args>
+    friend SharedPtr<T> MakeShared(Args&&... args);
+
+    InplaceKey() {
+    }
+
+public:
+    InplaceKey(const InplaceKey& other) = delete;
+    InplaceKey& operator=(const InplaceKey& other) = delete;
+};
+
+// Stateless `EnableSharedFromThis`: the object lives inside the `ControlBlockInplace` made
+// by `MakeShared<T>`, so the block is found by subtracting a constant from `this`.
+// `SharedFromThis()` is a single increment and the object carries no `WeakPtr`.
+//
+// `T` must be the class deriving from this one. Its constructors take a
+// `const InplaceKey&` first and pass it on to this base; `MakeShared<T>(args...)`
+// calls `T(key, args...)`. Nothing else can make a key, so a `T` can't be created
+// anywhere but in its control block: not on the stack, not with `new`, not as a copy.
+// Calling `SharedFromThis()` from the constructor or the destructor is undefined.
+template <typename T>
+class EnableSharedFromThisInplace : public EnableSharedFromThisInplaceBase {
+protected:
+    explicit EnableSharedFromThisInplace(const InplaceKey&) {
+    }
+    EnableSharedFromThisInplace(const EnableSharedFromThisInplace& other) = delete;
+    EnableSharedFromThisInplace& operator=(const EnableSharedFromThisInplace& other) = default;
+    ~EnableSharedFromThisInplace() = default;
+
+public:
+    SharedPtr<T> SharedFromThis() {
+        SharedPtr<T> res;
+        res.block_ = Block();
+        res.block_->IncStr();
+        res.ptr_ = static_cast<T*>(this);
+        return res;
+    }
+    SharedPtr<const T> SharedFromThis() const {
+        SharedPtr<const T> res;
+        res.block_ = Block();
+        res.block_->IncStr();
+        res.ptr_ = static_cast<const T*>(this);
+        return res;
+    }
+
+    WeakPtr<T> WeakFromThis() noexcept {
+        WeakPtr<T> res;
+        res.ptr_ = static_cast<T*>(this);
+        res.block_ = Block();
+        res.block_->IncWeak();
+        return res;
+    }
+    WeakPtr<const T> WeakFromThis() const noexcept {
+        WeakPtr<const T> res;
+        res.ptr_ = static_cast<const T*>(this);
+        res.block_ = Block();
+        res.block_->IncWeak();
+        return res;
+    }
+
+private:
+    ControlBlockBase* Block() const noexcept {
+        return ControlBlockInplace<T>::FromObject(static_cast<const T*>(this));
+    }
+};
+
+template <typename T>
+inline constexpr bool kSharesFromBlock =
+    std::is_convertible_v<T*, EnableSharedFromThisInplaceBase*>;
+
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 template <typename T>
 class SharedPtr {
@@ -151,8 +289,10 @@ public:
 
     template <typename U>
     explicit SharedPtr(U* ptr) {
+        static_assert(!kSharesFromBlock<U>, "EnableSharedFromThisInplace needs MakeShared");
         block_ = new ControlBlockPtr<U>(ptr);
         ptr_ = static_cast<T*>(ptr);
+        SMART_POINTERS_PROFILE_ALLOC(ptr, ProfiledSize<U>());
         // assert(std::is_convertible_v<T*, EnableSharedFromThisBase*>);
         if constexpr (std::is_convertible_v<T*, EnableSharedFromThisBase*>) {
             InitWeakThis(ptr_);
@@ -210,7 +350,7 @@ public:
                 throw BadWeakPtr{};
             }
             block_->IncStr();
-            ptr_ = reinterpret_cast<T*>(block_->GetObj());
+            ptr_ = other.ptr_;
         } else {
             throw BadWeakPtr{};
         }
@@ -252,23 +392,18 @@ public:
 
     void Reset() {
         if (block_ != nullptr) {
-            block_->DecStr();
-            if (block_->strong == 0) {
-                block_->DestroyObject();
-                block_->DecWeak();
-            }
-            if (block_ != nullptr && block_->strong == 0 && block_->weak == 0) {
-                block_->DeleteBlock();
-            }
+            ControlBlockBase* block = std::exchange(block_, nullptr);
             ptr_ = nullptr;
-            block_ = nullptr;
+            block->ReleaseStrong();
         }
     }
     template <typename U>
     void Reset(U* ptr) {
+        static_assert(!kSharesFromBlock<U>, "EnableSharedFromThisInplace needs MakeShared");
         Reset();
         block_ = new ControlBlockPtr<U>(ptr);
         ptr_ = static_cast<T*>(ptr);
+        SMART_POINTERS_PROFILE_ALLOC(ptr, ProfiledSize<U>());
     }
     void Swap(SharedPtr& other) {
         std::swap(ptr_, other.ptr_);
@@ -306,12 +441,53 @@ inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
     return left.block_ == right.block_;
 }
 
-// Allocate memory only once
+// Objects larger than this are not placed into the control block by `MakeShared`:
+// an inplace object's memory stays pinned by `WeakPtr`-s after it is destroyed.
+inline constexpr size_t kMakeSharedInplaceLimit = 1024;
+
+// Allocate memory only once (twice for objects above `kMakeSharedInplaceLimit`,
+// so that weak-only blocks shrink to the size of the block; objects using
+// `EnableSharedFromThisInplace` are always inplace)
 template <typename T, typename... Args>
 SharedPtr<T> MakeShared(Args&&... args) {
+    static_assert(!kSharesFromBlock<T> || std::is_base_of_v<EnableSharedFromThisInplace<T>, T>,
+                  "T must derive from EnableSharedFromThisInplace<T> itself");
+    SharedPtr<T> res;
+    if constexpr (sizeof(T) > kMakeSharedInplaceLimit && !kSharesFromBlock<T>) {
+        T* obj = new T(std::forward<Args>(args)...);
+        try {
+            res.block_ = new ControlBlockPtr<T>(obj);
+        } catch (...) {
+            delete obj;
+            throw;
+        }
+    } else if constexpr (kSharesFromBlock<T>) {
+        InplaceKey key;
+        res.block_ = new ControlBlockInplace<T>(key, std::forward<Args>(args)...);
+    } else {
+        res.block_ = new ControlBlockInplace<T>(std::forward<Args>(args)...);
+    }
+    res.ptr_ = reinterpret_cast<T*>(res.block_->GetObj());
+    SMART_POINTERS_PROFILE_ALLOC(res.ptr_, sizeof(T));
+
+    if constexpr (std::is_convertible_v<T*, EnableSharedFromThisBase*>) {
+        res.InitWeakThis(res.ptr_);
+    }
+    return res;
+}
+
+// `MakeShared` for objects written by one thread while other threads copy pointers to them:
+// the object gets its own cache lines, at the cost of up to two extra lines of memory.
+// Counters of `SharedPtr` are not atomic, so copies on other threads still need
+// external synchronization; the padding only removes the false sharing with the object.
+// `MakeAtomicSharedPadded` (core.h) is the same layout for pointers copied concurrently.
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedPadded(Args&&... args) {
+    static_assert(!kSharesFromBlock<T>, "EnableSharedFromThisInplace needs MakeShared");
     SharedPtr<T> res;
-    res.block_ = new ControlBlockInplace<T>(std::forward<Args>(args)...);
+    res.block_ = new ControlBlockInplacePadded<T>(std::forward<Args>(args)...);
     res.ptr_ = reinterpret_cast<T*>(res.block_->GetObj());
+    SMART_POINTERS_PROFILE_ALLOC(res.ptr_, sizeof(T));
 
     if constexpr (std::is_convertible_v<T*, EnableSharedFromThisBase*>) {
         res.InitWeakThis(res.ptr_);
@@ -12,12 +12,14 @@ public:
     // Constructors
 
     WeakPtr() {
+        ptr_ = nullptr;
         block_ = nullptr;
     }
     WeakPtr(std::nullptr_t) : WeakPtr() {
     }
 
     WeakPtr(const WeakPtr& other) {
+        ptr_ = other.ptr_;
         block_ = other.block_;
         if (block_) {
             block_->IncWeak();
@@ -25,19 +27,23 @@ public:
     }
     template <typename U>
     WeakPtr(const WeakPtr<U>& other) {
+        ptr_ = other.ptr_;
         block_ = other.block_;
         if (block_) {
             block_->IncWeak();
         }
     }
     WeakPtr(WeakPtr&& other) {
+        ptr_ = other.ptr_;
         block_ = other.block_;
+        other.ptr_ = nullptr;
         other.block_ = nullptr;
     }
 
     // Demote `SharedPtr`
     // #2 from https://en.cppreference.com/w/cpp/memory/weak_ptr/weak_ptr
     WeakPtr(const SharedPtr<T>& other) {
+        ptr_ = other.ptr_;
         block_ = other.block_;
         if (block_ != nullptr) {
             block_->IncWeak();
@@ -46,6 +52,7 @@ public:
     template <typename U>
     WeakPtr& operator=(const SharedPtr<U>& other) {
         Reset();
+        ptr_ = other.ptr_;
         block_ = other.block_;
         if (block_) {
             block_->IncWeak();
@@ -61,6 +68,7 @@ public:
             return *this;
         }
         Reset();
+        ptr_ = other.ptr_;
         block_ = other.block_;
         if (block_) {
             block_->IncWeak();
@@ -69,7 +77,9 @@ public:
     }
     WeakPtr& operator=(WeakPtr&& other) {
         Reset();
+        ptr_ = other.ptr_;
         block_ = other.block_;
+        other.ptr_ = nullptr;
         other.block_ = nullptr;
         return *this;
     }
@@ -88,13 +98,12 @@ public:
         if (block_ == nullptr) {
             return;
         }
-        block_->DecWeak();
-        if (block_->strong == 0 && block_->weak == 0) {
-            block_->DeleteBlock();
-        }
-        block_ = nullptr;
+        ControlBlockBase* block = std::exchange(block_, nullptr);
+        ptr_ = nullptr;
+        block->ReleaseWeak();
     }
     void Swap(WeakPtr& other) {
+        std::swap(ptr_, other.ptr_);
         std::swap(block_, other.block_);
     }
 
@@ -115,10 +124,12 @@ public:
         if (block_ != nullptr && block_->strong > 0) {
             block_->IncStr();
             res.block_ = block_;
-            res.ptr_ = reinterpret_cast<T*>(block_->GetObj());
+            res.ptr_ = ptr_;
         }
         return res;
     }
 
+    // The object this pointer was made from, so that `Lock()` keeps aliases
+    T* ptr_;
     ControlBlockBase* block_;
 };
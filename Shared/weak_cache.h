@@ -0,0 +1,147 @@
+#pragma once
+
+#include "../core.h"
+
+#include <cstddef>  // size_t
+#include <functional>
+#include <memory>  // std::unique_ptr
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Cache of objects that lives only as long as somebody outside holds them.
+// Values are stored as `AtomicWeakPtr<T>`, so an entry never keeps its object alive:
+// once the last `AtomicSharedPtr` is gone the entry is expired and gets dropped lazily,
+// either when its key is looked up again or by a `Sweep()`.
+//
+// Keys are spread over independent shards, each guarded by its own mutex, so
+// lookups of different keys rarely contend. Counts are atomic, so the returned
+// pointers may be copied and dropped on any thread. `SharedPtr`/`WeakPtr` can't be
+// used here: their counters are not atomic.
+template <typename K, typename T, typename Hash = std::hash<K>>
+class WeakValueCache {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    // `hash` picks the shard and is handed to every shard's map, so it may carry state.
+    explicit WeakValueCache(size_t shard_count = 16, const Hash& hash = Hash())
+        : hash_(hash), shard_count_(shard_count == 0 ? 1 : shard_count),
+          shards_(new Shard[shard_count_]) {
+        for (size_t i = 0; i < shard_count_; ++i) {
+            shards_[i].entries = Map(0, hash_);
+        }
+    }
+
+    WeakValueCache(const WeakValueCache& other) = delete;
+    WeakValueCache& operator=(const WeakValueCache& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Lookup
+
+    // Returns the cached object or constructs a new one from `args`.
+    // The object is built under the shard lock, so concurrent callers with the same key
+    // always get the same instance.
+    template <typename... Args>
+    AtomicSharedPtr<T> GetOrCreate(const K& key, Args&&... args) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            AtomicSharedPtr<T> res = it->second.Lock();
+            if (res) {
+                return res;
+            }
+        }
+        AtomicSharedPtr<T> res = MakeAtomicShared<T>(std::forward<Args>(args)...);
+        if (it != shard.entries.end()) {
+            it->second = res;
+        } else {
+            shard.entries.emplace(key, AtomicWeakPtr<T>(res));
+            if (shard.entries.size() >= 2 * shard.swept_size) {
+                SweepShard(shard);
+            }
+        }
+        return res;
+    }
+
+    // Returns the cached object or an empty pointer if the key is missing or expired.
+    AtomicSharedPtr<T> Find(const K& key) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            return nullptr;
+        }
+        AtomicSharedPtr<T> res = it->second.Lock();
+        if (!res) {
+            shard.entries.erase(it);
+        }
+        return res;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Erase(const K& key) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        shard.entries.erase(key);
+    }
+
+    // Drops every expired entry, returns the number of removed entries.
+    size_t Sweep() {
+        size_t removed = 0;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::lock_guard<std::mutex> guard(shards_[i].mutex);
+            removed += SweepShard(shards_[i]);
+        }
+        return removed;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Number of stored entries, expired ones included until they are swept.
+    size_t Size() const {
+        size_t size = 0;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::lock_guard<std::mutex> guard(shards_[i].mutex);
+            size += shards_[i].entries.size();
+        }
+        return size;
+    }
+
+private:
+    using Map = std::unordered_map<K, AtomicWeakPtr<T>, Hash>;
+
+    // Shards sit on separate cache lines so that their mutexes don't false-share.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        Map entries;
+        // Size right after the last sweep; the shard is swept again once it doubles.
+        size_t swept_size = 8;
+    };
+
+    Shard& ShardFor(const K& key) const {
+        return shards_[hash_(key) % shard_count_];
+    }
+
+    static size_t SweepShard(Shard& shard) {
+        size_t removed = 0;
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            if (it->second.Expired()) {
+                it = shard.entries.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+        shard.swept_size = shard.entries.size() < 8 ? 8 : shard.entries.size();
+        return removed;
+    }
+
+    Hash hash_;
+    size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "compressed_pair.h"
+
+#include <cstddef>  // std::nullptr_t, std::max_align_t
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Owning pointer with value semantics for polymorphic objects: copying a `PolyValue<Base>`
+// copies the derived object it holds, no hand-written `Clone()` needed.
+// Derived objects of up to `BufferSize` bytes with a noexcept move constructor are stored
+// inline and never touch the heap, bigger ones are allocated with `new`.
+//
+// `Base` must be a non-virtual base of every stored type.
+template <typename Base, size_t BufferSize = 48>
+class PolyValue {
+    // Type-erased operations, one static table per stored type
+    struct Ops {
+        Base* (*copy)(const Base* src, void* buffer);
+        Base* (*move)(Base* src, void* buffer) noexcept;
+        void (*destroy)(Base* obj) noexcept;
+        // The object lives in the small buffer (its `Base` part need not start the buffer)
+        bool is_inline;
+    };
+
+    template <typename D>
+    struct OpsFor {
+        static constexpr bool kInline = sizeof(D) <= BufferSize &&
+                                        alignof(D) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<D>;
+
+        static Base* Copy(const Base* src, void* buffer) {
+            const D& obj = static_cast<const D&>(*src);
+            if constexpr (kInline) {
+                return ::new (buffer) D(obj);
+            } else {
+                return new D(obj);
+            }
+        }
+        // Heap objects are just handed over, inline ones are moved into `buffer`
+        static Base* Move(Base* src, void* buffer) noexcept {
+            if constexpr (kInline) {
+                D* obj = static_cast<D*>(src);
+                D* res = ::new (buffer) D(std::move(*obj));
+                obj->~D();
+                return res;
+            } else {
+                return src;
+            }
+        }
+        static void Destroy(Base* obj) noexcept {
+            if constexpr (kInline) {
+                static_cast<D*>(obj)->~D();
+            } else {
+                delete static_cast<D*>(obj);
+            }
+        }
+
+        static constexpr Ops kOps{&Copy, &Move, &Destroy, kInline};
+    };
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    PolyValue() : object_(nullptr, nullptr) {
+    }
+    PolyValue(std::nullptr_t) : PolyValue() {
+    }
+
+    template <typename D, typename = std::enable_if_t<std::is_base_of_v<Base, std::decay_t<D>>>>
+    PolyValue(D&& value) : PolyValue() {
+        Emplace<std::decay_t<D>>(std::forward<D>(value));
+    }
+
+    PolyValue(const PolyValue& other) : PolyValue() {
+        if (other.Get()) {
+            object_.GetFirst() = other.object_.GetSecond()->copy(other.Get(), buffer_);
+            object_.GetSecond() = other.object_.GetSecond();
+        }
+    }
+    PolyValue(PolyValue&& other) noexcept : PolyValue() {
+        Steal(other);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    PolyValue& operator=(const PolyValue& other) {
+        if (this == &other) {
+            return *this;
+        }
+        PolyValue copy(other);
+        Reset();
+        Steal(copy);
+        return *this;
+    }
+    PolyValue& operator=(PolyValue&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        Steal(other);
+        return *this;
+    }
+    PolyValue& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~PolyValue() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Destroys the current object and constructs a `D` in its place.
+    template <typename D, typename... Args>
+    D& Emplace(Args&&... args) {
+        static_assert(std::is_base_of_v<Base, D>);
+        static_assert(std::is_copy_constructible_v<D>, "PolyValue copies hold deep copies");
+        Reset();
+        D* obj;
+        if constexpr (OpsFor<D>::kInline) {
+            obj = ::new (static_cast<void*>(buffer_)) D(std::forward<Args>(args)...);
+        } else {
+            obj = new D(std::forward<Args>(args)...);
+        }
+        object_.GetFirst() = obj;
+        object_.GetSecond() = &OpsFor<D>::kOps;
+        return *obj;
+    }
+    void Reset() {
+        if (object_.GetFirst()) {
+            object_.GetSecond()->destroy(object_.GetFirst());
+            object_.GetFirst() = nullptr;
+            object_.GetSecond() = nullptr;
+        }
+    }
+    void Swap(PolyValue& other) {
+        PolyValue tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    Base* Get() {
+        return object_.GetFirst();
+    }
+    const Base* Get() const {
+        return object_.GetFirst();
+    }
+    Base& operator*() {
+        return *Get();
+    }
+    const Base& operator*() const {
+        return *Get();
+    }
+    Base* operator->() {
+        return Get();
+    }
+    const Base* operator->() const {
+        return Get();
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+    // True if the object lives in the small buffer
+    bool IsInline() const {
+        return Get() != nullptr && object_.GetSecond()->is_inline;
+    }
+
+private:
+    void Steal(PolyValue& other) noexcept {
+        if (other.Get()) {
+            object_.GetFirst() = other.object_.GetSecond()->move(other.Get(), buffer_);
+            object_.GetSecond() = other.object_.GetSecond();
+            other.object_.GetFirst() = nullptr;
+            other.object_.GetSecond() = nullptr;
+        }
+    }
+
+    CompressedPair<Base*, const Ops*> object_;
+    alignas(std::max_align_t) unsigned char buffer_[BufferSize];
+};
+
+template <typename Base, typename D, size_t BufferSize = 48, typename... Args>
+PolyValue<Base, BufferSize> MakePolyValue(Args&&... args) {
+    PolyValue<Base, BufferSize> res;
+    res.template Emplace<D>(std::forward<Args>(args)...);
+    return res;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Default deleter of `UniquePtr` and the other owning pointers
+template <typename T>
+struct Slug {
+    Slug() = default;
+
+    template <typename U>
+    Slug(const Slug<U>&) noexcept {
+    }
+
+    template <typename U>
+    Slug(Slug<U>&&) noexcept {
+    }
+
+    template <typename U>
+    Slug& operator=(const Slug<U>&) noexcept {
+        return *this;
+    }
+
+    template <typename U>
+    Slug& operator=(Slug<U>&&) noexcept {
+        return *this;
+    }
+
+    void operator()(T* ptr) const noexcept {
+        delete ptr;
+    }
+};
+
+template <typename T>
+struct Slug<T[]> {
+    void operator()(T* ptr) const noexcept {
+        delete[] ptr;
+    }
+};
@@ -0,0 +1,81 @@
+// `ReleaseAll` against element-wise destruction (`std::vector::clear`) of long vectors of
+// smart pointers whose objects are scattered over the heap.
+//
+//     g++ -std=c++17 -O2 bench/bulk_release.cpp -o bulk_release_bench && ./bulk_release_bench
+
+#include "../Shared/shared.h"
+#include "../Unique/unique.h"
+#include "../bulk_release.h"
+#include "../intrusive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t kRounds = 5;
+
+struct Payload {
+    size_t value[4] = {};
+};
+
+struct Counted : SimpleRefCounted<Counted> {
+    Payload payload;
+};
+
+// Allocated in order and then shuffled, so that neighbouring pointers refer to far apart
+// objects, as in a long-lived program
+template <typename Ptr, typename Make>
+std::vector<Ptr> Build(size_t count, Make make) {
+    std::vector<Ptr> pointers;
+    pointers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        pointers.push_back(make());
+    }
+    std::shuffle(pointers.begin(), pointers.end(), std::mt19937_64(count));
+    return pointers;
+}
+
+// Best of `kRounds` release times in nanoseconds per pointer
+template <typename Ptr, typename Make, typename Release>
+double Time(size_t count, Make make, Release release) {
+    double best = 0;
+    for (size_t round = 0; round < kRounds; ++round) {
+        std::vector<Ptr> pointers = Build<Ptr>(count, make);
+        auto start = std::chrono::steady_clock::now();
+        release(pointers);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        double per_pointer = elapsed.count() / count;
+        if (round == 0 || per_pointer < best) {
+            best = per_pointer;
+        }
+    }
+    return best;
+}
+
+template <typename Ptr, typename Make>
+void Compare(const char* name, size_t count, Make make) {
+    auto clear = [](std::vector<Ptr>& pointers) { pointers.clear(); };
+    auto release_all = [](std::vector<Ptr>& pointers) { ReleaseAll(pointers); };
+    double element_wise = Time<Ptr>(count, make, clear);
+    double bulk = Time<Ptr>(count, make, release_all);
+    std::printf("%-14s %10zu %12.2f ns %12.2f ns %8.2fx\n", name, count, element_wise, bulk,
+                element_wise / bulk);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-14s %10s %15s %15s %9s\n", "pointer", "count", "clear()", "ReleaseAll",
+                "speedup");
+    for (size_t count : {size_t{1} << 12, size_t{1} << 16, size_t{1} << 20}) {
+        Compare<SharedPtr<Payload>>("SharedPtr", count, [] { return MakeShared<Payload>(); });
+        Compare<IntrusivePtr<Counted>>("IntrusivePtr", count,
+                                       [] { return MakeIntrusive<Counted>(); });
+        Compare<UniquePtr<Payload>>("UniquePtr", count,
+                                    [] { return UniquePtr<Payload>(new Payload()); });
+    }
+}
@@ -0,0 +1,111 @@
+// False sharing between reference counts and object data: one thread keeps writing an
+// object while the others copy and drop pointers to it. Compares the packed layouts with
+// the padded ones, `MakeAtomicShared` against `MakeAtomicSharedPadded` and `RefCounted`
+// with `AtomicCounter` against `PaddedCounter<AtomicCounter>`.
+//
+//     g++ -std=c++17 -O2 -pthread bench/false_sharing.cpp -o false_sharing_bench
+//     ./false_sharing_bench
+
+#include "../core.h"
+#include "../intrusive.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kIterations = 2'000'000;
+
+struct Payload {
+    std::atomic<size_t> value{0};
+};
+
+template <typename Counter>
+struct Counted : RefCounted<Counted<Counter>, Counter, DefaultDelete> {
+    std::atomic<size_t> value{0};
+};
+
+struct Result {
+    // Millions of writes and of pointer copies per second
+    double writes;
+    double copies;
+};
+
+// The writer and `copiers` threads run `kIterations` steps each, all starting together
+template <typename Ptr>
+Result Run(const Ptr& ptr, size_t copiers) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    double write_seconds = 0;
+    std::vector<double> copy_seconds(copiers);
+    auto wait = [&] {
+        ready.fetch_add(1);
+        while (!go.load()) {
+            std::this_thread::yield();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        wait();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kIterations; ++i) {
+            ptr->value.store(i, std::memory_order_relaxed);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        write_seconds = elapsed.count();
+    });
+    for (size_t t = 0; t < copiers; ++t) {
+        threads.emplace_back([&, t] {
+            wait();
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < kIterations; ++i) {
+                Ptr copy = ptr;
+                (void)copy;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            copy_seconds[t] = elapsed.count();
+        });
+    }
+    while (ready.load() != copiers + 1) {
+        std::this_thread::yield();
+    }
+    go.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    double copy_rate = 0;
+    for (double seconds : copy_seconds) {
+        copy_rate += kIterations / seconds / 1e6;
+    }
+    return {kIterations / write_seconds / 1e6, copy_rate};
+}
+
+void Print(const char* name, size_t copiers, Result packed, Result padded) {
+    std::printf("%-16s %7zu %9.1f %9.1f %9.1f %9.1f\n", name, copiers, packed.writes,
+                padded.writes, packed.copies, padded.copies);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-16s %7s %19s %19s\n", "", "", "writes, M/s", "copies, M/s");
+    std::printf("%-16s %7s %9s %9s %9s %9s\n", "pointer", "copiers", "packed", "padded",
+                "packed", "padded");
+    unsigned hardware = std::thread::hardware_concurrency();
+    size_t max_copiers = hardware > 1 ? hardware - 1 : 1;
+    for (size_t copiers = 1; copiers <= max_copiers; copiers *= 2) {
+        AtomicSharedPtr<Payload> shared = MakeAtomicShared<Payload>();
+        AtomicSharedPtr<Payload> shared_padded = MakeAtomicSharedPadded<Payload>();
+        Print("AtomicSharedPtr", copiers, Run(shared, copiers), Run(shared_padded, copiers));
+
+        IntrusivePtr<Counted<AtomicCounter>> intrusive = MakeIntrusive<Counted<AtomicCounter>>();
+        IntrusivePtr<Counted<PaddedCounter<AtomicCounter>>> intrusive_padded =
+            MakeIntrusive<Counted<PaddedCounter<AtomicCounter>>>();
+        Print("IntrusivePtr", copiers, Run(intrusive, copiers), Run(intrusive_padded, copiers));
+    }
+}
@@ -0,0 +1,137 @@
+// Throughput of `MpmcQueue`/`TreiberStack` against a mutex-guarded std::deque/std::vector,
+// passing `UniquePtr`-s from producer threads to consumer threads.
+//
+//     g++ -std=c++17 -O2 -pthread bench/lockfree.cpp -o lockfree_bench && ./lockfree_bench
+
+#include "../Unique/unique.h"
+#include "../lockfree.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kItemsPerProducer = 1'000'000;
+constexpr size_t kCapacity = 1024;
+
+using Item = UniquePtr<size_t>;
+
+template <typename T>
+class LockedDeque {
+public:
+    bool TryPush(T&& value) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (items_.size() == kCapacity) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        return true;
+    }
+    bool TryPop(T& out) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        out = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<T> items_;
+};
+
+template <typename T>
+class LockedStack {
+public:
+    bool TryPush(T&& value) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (items_.size() == kCapacity) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        return true;
+    }
+    bool TryPop(T& out) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        out = std::move(items_.back());
+        items_.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<T> items_;
+};
+
+// Runs `threads` producer/consumer pairs: every producer pushes `kItemsPerProducer` items,
+// consumers pop until all are taken. Returns millions of items per second.
+template <typename Container>
+double Run(Container& container, size_t threads) {
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> checksum{0};
+    size_t total = threads * kItemsPerProducer;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = 0; i < kItemsPerProducer; ++i) {
+                Item item(new size_t(i));
+                while (!container.TryPush(std::move(item))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        workers.emplace_back([&] {
+            Item item;
+            size_t sum = 0;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (container.TryPop(item)) {
+                    sum += *item;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            checksum.fetch_add(sum);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum.load() != threads * (kItemsPerProducer * (kItemsPerProducer - 1) / 2)) {
+        std::printf("checksum mismatch\n");
+    }
+    return total / elapsed.count() / 1e6;
+}
+
+}  // namespace
+
+int main() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    std::printf("%-8s %14s %14s %14s %14s\n", "pairs", "MpmcQueue", "mutex+deque",
+                "TreiberStack", "mutex+vector");
+    for (size_t threads = 1; threads <= (hardware > 2 ? hardware / 2 : 1); threads *= 2) {
+        MpmcQueue<Item> queue(kCapacity);
+        LockedDeque<Item> deque;
+        TreiberStack<Item> stack(kCapacity);
+        LockedStack<Item> vector;
+        double queue_rate = Run(queue, threads);
+        double deque_rate = Run(deque, threads);
+        double stack_rate = Run(stack, threads);
+        double vector_rate = Run(vector, threads);
+        std::printf("%-8zu %11.2f M/s %11.2f M/s %11.2f M/s %11.2f M/s\n", threads, queue_rate,
+                    deque_rate, stack_rate, vector_rate);
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Shared/shared.h"
+#include "intrusive.h"
+
+#include <cassert>
+#include <cstddef>  // std::nullptr_t
+#include <type_traits>
+#include <utility>
+
+// With borrow checking on, every access asserts that the owner is still alive.
+// Borrows from a `SharedPtr` then hold a weak reference to keep the control block readable;
+// borrows from an `IntrusivePtr` can only check the counter of the object itself.
+// Checking changes the layout of `BorrowedPtr`, so it must be set the same way in every
+// translation unit. With it off a borrow is a trivially copyable pair of pointers.
+#ifndef SMART_POINTERS_CHECK_BORROWS
+#ifdef NDEBUG
+#define SMART_POINTERS_CHECK_BORROWS 0
+#else
+#define SMART_POINTERS_CHECK_BORROWS 1
+#endif
+#endif
+
+// Non-owning view of an object owned by a `SharedPtr` or an `IntrusivePtr`.
+// Making, copying and dropping a borrow never touches the reference count, so it can be
+// passed down deep call chains for free; the caller guarantees that an owner outlives it.
+// `ToShared()`/`ToIntrusive()` turn it back into an owner when one must be kept.
+template <typename T>
+class BorrowedPtr {
+    template <typename Y>
+    friend class BorrowedPtr;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    BorrowedPtr() : ptr_(nullptr), block_(nullptr) {
+    }
+    BorrowedPtr(std::nullptr_t) : BorrowedPtr() {
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BorrowedPtr(const SharedPtr<U>& owner) : ptr_(owner.Get()), block_(owner.block_) {
+        Acquire();
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BorrowedPtr(const IntrusivePtr<U>& owner) : ptr_(owner.Get()), block_(nullptr) {
+#if SMART_POINTERS_CHECK_BORROWS
+        if (ptr_) {
+            // The counter is read through the original `U*`, `ptr_` may point to a base
+            counted_ = owner.Get();
+            ref_count_ = &RefCountOf<U>;
+        }
+#endif
+    }
+
+#if SMART_POINTERS_CHECK_BORROWS
+    BorrowedPtr(const BorrowedPtr& other) : ptr_(other.ptr_), block_(other.block_) {
+        CopyChecker(other);
+        Acquire();
+    }
+#else
+    BorrowedPtr(const BorrowedPtr& other) = default;
+#endif
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BorrowedPtr(const BorrowedPtr<U>& other) : ptr_(other.ptr_), block_(other.block_) {
+        CopyChecker(other);
+        Acquire();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+#if SMART_POINTERS_CHECK_BORROWS
+    BorrowedPtr& operator=(const BorrowedPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Release();
+        ptr_ = other.ptr_;
+        block_ = other.block_;
+        CopyChecker(other);
+        Acquire();
+        return *this;
+    }
+#else
+    BorrowedPtr& operator=(const BorrowedPtr& other) = default;
+#endif
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+#if SMART_POINTERS_CHECK_BORROWS
+    ~BorrowedPtr() {
+        Release();
+    }
+#else
+    ~BorrowedPtr() = default;
+#endif
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Promotion
+
+    // New owner sharing the control block of the original `SharedPtr`.
+    SharedPtr<T> ToShared() const {
+        assert((ptr_ == nullptr || block_ != nullptr) && "Not borrowed from a SharedPtr");
+        SharedPtr<T> res;
+        if (block_ != nullptr) {
+            Check();
+            block_->IncStr();
+            res.block_ = block_;
+            res.ptr_ = ptr_;
+        }
+        return res;
+    }
+    // New owner of an intrusively counted object.
+    IntrusivePtr<T> ToIntrusive() const {
+        assert(block_ == nullptr && "Borrowed from a SharedPtr");
+        Check();
+        return IntrusivePtr<T>(ptr_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        Check();
+        return ptr_;
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+private:
+    template <typename U>
+    static size_t RefCountOf(const void* obj) {
+        return static_cast<const U*>(obj)->RefCount();
+    }
+
+    template <typename U>
+    void CopyChecker([[maybe_unused]] const BorrowedPtr<U>& other) {
+#if SMART_POINTERS_CHECK_BORROWS
+        counted_ = other.counted_;
+        ref_count_ = other.ref_count_;
+#endif
+    }
+    // Checked borrows of a `SharedPtr` hold a weak reference
+    void Acquire() {
+#if SMART_POINTERS_CHECK_BORROWS
+        if (block_ != nullptr) {
+            block_->IncWeak();
+        }
+#endif
+    }
+    void Release() {
+#if SMART_POINTERS_CHECK_BORROWS
+        if (block_ != nullptr) {
+            block_->ReleaseWeak();
+        }
+#endif
+    }
+    void Check() const {
+#if SMART_POINTERS_CHECK_BORROWS
+        if (block_ != nullptr) {
+            assert(block_->strong > 0 && "BorrowedPtr outlived its owner");
+        } else if (ref_count_ != nullptr) {
+            assert(ref_count_(counted_) > 0 && "BorrowedPtr outlived its owner");
+        }
+#endif
+    }
+
+    T* ptr_;
+    ControlBlockBase* block_;
+#if SMART_POINTERS_CHECK_BORROWS
+    // Set only on borrows of an `IntrusivePtr`: the original object and how to read its count
+    const void* counted_ = nullptr;
+    size_t (*ref_count_)(const void*) = nullptr;
+#endif
+};
+
+template <typename T, typename U>
+inline bool operator==(const BorrowedPtr<T>& left, const BorrowedPtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+#if !SMART_POINTERS_CHECK_BORROWS
+static_assert(std::is_trivially_copyable_v<BorrowedPtr<int>>);
+static_assert(sizeof(BorrowedPtr<int>) == 2 * sizeof(void*));
+#endif
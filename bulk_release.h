@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Shared/shared.h"
+#include "Unique/unique.h"
+#include "intrusive.h"
+
+#include <cstddef>  // size_t
+#include <vector>
+
+// Releasing a long array of smart pointers one by one stalls on a cache miss per element:
+// every counter lives somewhere else in memory. `ReleaseAll` walks the range once,
+// prefetching counters a few elements ahead, and leaves every pointer empty.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SMART_POINTERS_PREFETCH(addr) __builtin_prefetch((addr), 1)
+#else
+#define SMART_POINTERS_PREFETCH(addr) ((void)(addr))
+#endif
+
+inline constexpr size_t kReleasePrefetchDistance = 8;
+inline constexpr size_t kReleaseBatch = 256;
+
+// `SharedPtr`-s are released in batches of `kReleaseBatch`, with two passes over each: the
+// first one only decrements counters and collects the blocks that reached zero, the second
+// one destroys those objects while their blocks are still in cache. The batch lives on the
+// stack, so nothing is allocated and nothing can throw halfway through the range.
+template <typename T>
+void ReleaseAll(SharedPtr<T>* first, SharedPtr<T>* last) {
+    size_t count = last - first;
+    ControlBlockBase* dead[kReleaseBatch];
+    for (size_t begin = 0; begin < count; begin += kReleaseBatch) {
+        size_t end = count - begin < kReleaseBatch ? count : begin + kReleaseBatch;
+        size_t dead_count = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (i + kReleasePrefetchDistance < count) {
+                SMART_POINTERS_PREFETCH(first[i + kReleasePrefetchDistance].block_);
+            }
+            ControlBlockBase* block = first[i].block_;
+            if (block != nullptr) {
+                block->DecStr();
+                if (block->strong == 0) {
+                    dead[dead_count++] = block;
+                }
+            }
+            first[i].block_ = nullptr;
+            first[i].ptr_ = nullptr;
+        }
+        // Dead blocks still hold the weak reference of their strong owners, so destructors
+        // dropping `WeakPtr`-s to them can't free them under us.
+        for (size_t i = 0; i < dead_count; ++i) {
+            dead[i]->DestroyObject();
+            dead[i]->ReleaseWeak();
+        }
+    }
+}
+
+// The counter of an intrusive object is private to it and `DecRef` destroys in place,
+// so only the prefetch applies.
+template <typename T>
+void ReleaseAll(IntrusivePtr<T>* first, IntrusivePtr<T>* last) {
+    size_t count = last - first;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + kReleasePrefetchDistance < count) {
+            SMART_POINTERS_PREFETCH(first[i + kReleasePrefetchDistance].Get());
+        }
+        first[i].Reset();
+    }
+}
+
+template <typename T, typename Deleter>
+void ReleaseAll(UniquePtr<T, Deleter>* first, UniquePtr<T, Deleter>* last) {
+    size_t count = last - first;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + kReleasePrefetchDistance < count) {
+            SMART_POINTERS_PREFETCH(first[i + kReleasePrefetchDistance].Get());
+        }
+        first[i].Reset();
+    }
+}
+
+// Releases every element and clears the vector.
+template <typename Ptr>
+void ReleaseAll(std::vector<Ptr>& pointers) {
+    ReleaseAll(pointers.data(), pointers.data() + pointers.size());
+    pointers.clear();
+}
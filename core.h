@@ -0,0 +1,546 @@
+#pragma once
+
+#include "Unique/compressed_pair.h"
+#include "Unique/slug.h"
+#include "counters.h"
+#include "profiler.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Policy-driven owning pointer. One template covers
+//   * where the count lives: `ExternalCount` (separate block), `IntrusiveCount` (inside
+//     the object, see `RefCounted`) or `NoCount` (unique ownership),
+//   * how it is updated: any counter with the `SimpleCounter` interface,
+//     e.g. `SimpleCounter` or `AtomicCounter`,
+//   * how the object is destroyed: a `UniquePtr`-style deleter. Shared objects keep it
+//     in their block, as `ControlBlockPtr` does, so every owner destroys the object
+//     the way it was created, whatever pointer type it is held by.
+// Unused parts cost nothing: branches are `if constexpr` and the block pointer and deleter
+// are packed with `CompressedPair`, so e.g. `BasicPtr<T, NoCount>` is a single word.
+// Objects with an external count can also be observed by `BasicWeakPtr`.
+//
+// `IntrusivePtr` (intrusive.h) and `UniquePtr` (Unique/unique.h) are aliases of it.
+// `SharedPtr` keeps its own control blocks, which also serve `WeakPtr`,
+// `EnableSharedFromThis` and the single-allocation `MakeShared`.
+// There is no allocator policy: blocks come from `new`, objects go to their deleter.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Counting policies
+
+struct ExternalCount {};
+struct IntrusiveCount {};
+struct NoCount {};
+
+template <typename Counter>
+struct CountBlock {
+    Counter counter;
+    // Weak references, plus one held by all strong references together
+    Counter weak;
+
+    virtual void DestroyObject() noexcept = 0;
+
+    virtual ~CountBlock() = default;
+
+    void ReleaseStrong() noexcept {
+        if (counter.DecRef() == 0) {
+            DestroyObject();
+            ReleaseWeak();
+        }
+    }
+    void ReleaseWeak() noexcept {
+        if (weak.DecRef() == 0) {
+            delete this;
+        }
+    }
+};
+
+// Remembers the object as it was adopted, `U*` and its deleter
+template <typename Counter, typename U, typename Deleter>
+struct CountBlockFor : CountBlock<Counter> {
+    CompressedPair<U*, Deleter> object;
+
+    CountBlockFor(U* ptr, Deleter deleter) {
+        object.GetFirst() = ptr;
+        object.GetSecond() = std::move(deleter);
+    }
+
+    void DestroyObject() noexcept override {
+        object.GetSecond()(object.GetFirst());
+    }
+};
+
+// Block and object in one allocation, see `MakeCoreShared`. A larger `Alignment` moves
+// the object away from the counters, see `MakeCoreSharedPadded`.
+template <typename Counter, typename T, size_t Alignment = alignof(T)>
+struct CountBlockInplace : CountBlock<Counter> {
+    alignas(Alignment) unsigned char storage[sizeof(T)];
+
+    template <typename... Args>
+    explicit CountBlockInplace(Args&&... args) {
+        ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T* Object() {
+        return std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void DestroyObject() noexcept override {
+        Object()->~T();
+    }
+};
+
+// Stands in for the block pointer when there is no block,
+// and for the deleter of counted pointers.
+struct NoBlock {};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// BasicPtr
+
+template <typename T, typename Counter>
+class BasicWeakPtr;
+
+template <typename T, typename Deleter>
+class NonNullUnique;
+
+template <typename T, typename Counting, typename Counter = SimpleCounter,
+          typename Deleter = Slug<T>>
+class BasicPtr {
+    template <typename Y, typename C, typename N, typename D>
+    friend class BasicPtr;
+    template <typename Y, typename N>
+    friend class BasicWeakPtr;
+    template <typename Y, typename D>
+    friend class NonNullUnique;
+    template <typename Y, typename N, typename... Args>
+    friend BasicPtr<Y, ExternalCount, N> MakeCoreShared(Args&&... args);
+    template <typename Y, typename N, typename... Args>
+    friend BasicPtr<Y, ExternalCount, N> MakeCoreSharedPadded(Args&&... args);
+
+    static constexpr bool kExternal = std::is_same_v<Counting, ExternalCount>;
+    static constexpr bool kIntrusive = std::is_same_v<Counting, IntrusiveCount>;
+    static constexpr bool kUnique = std::is_same_v<Counting, NoCount>;
+    static_assert(kExternal || kIntrusive || kUnique, "Unknown counting policy");
+    static_assert(kUnique || !std::is_array_v<T>, "Only unique pointers own arrays");
+
+    // `T`, or the element type of an array
+    using Element = std::remove_extent_t<T>;
+
+    using Block = std::conditional_t<kExternal, CountBlock<Counter>*, NoBlock>;
+    // Only a unique pointer destroys the object itself
+    using StoredDeleter = std::conditional_t<kUnique, Deleter, NoBlock>;
+
+    // Unique pointers take this instead of `const BasicPtr&`, so they get no copy
+    // operations: the implicit ones are deleted by the user-declared moves.
+    struct NotCopyable {};
+    using CopySource = std::conditional_t<kUnique, NotCopyable, BasicPtr>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    BasicPtr() {
+        Ptr() = nullptr;
+        ClearBlock();
+    }
+    BasicPtr(std::nullptr_t) : BasicPtr() {
+    }
+    // An intrusively counted object carries its count, so it converts implicitly
+    template <typename U = T, std::enable_if_t<std::is_same_v<U, T> && kIntrusive, int> = 0>
+    BasicPtr(Element* ptr) : BasicPtr() {
+        Adopt(ptr, Deleter());
+    }
+    template <typename U = T, std::enable_if_t<std::is_same_v<U, T> && !kIntrusive, int> = 0>
+    explicit BasicPtr(Element* ptr) : BasicPtr() {
+        Adopt(ptr, Deleter());
+    }
+    BasicPtr(Element* ptr, Deleter deleter) : BasicPtr() {
+        Adopt(ptr, std::move(deleter));
+    }
+
+    BasicPtr(const CopySource& other) : BasicPtr() {
+        CopyFrom(other);
+    }
+    template <typename U, typename E,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*> && !kUnique>>
+    BasicPtr(const BasicPtr<U, Counting, Counter, E>& other) : BasicPtr() {
+        CopyFrom(other);
+    }
+
+    BasicPtr(BasicPtr&& other) noexcept : BasicPtr() {
+        MoveFrom(other);
+    }
+    template <typename U, typename E, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BasicPtr(BasicPtr<U, Counting, Counter, E>&& other) noexcept : BasicPtr() {
+        MoveFrom(other);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    BasicPtr& operator=(const CopySource& other) {
+        if (this == &other) {
+            return *this;
+        }
+        BasicPtr copy(other);
+        Swap(copy);
+        return *this;
+    }
+    BasicPtr& operator=(BasicPtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        MoveFrom(other);
+        return *this;
+    }
+    template <typename U, typename E, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BasicPtr& operator=(BasicPtr<U, Counting, Counter, E>&& other) noexcept {
+        BasicPtr tmp(std::move(other));
+        Swap(tmp);
+        return *this;
+    }
+    BasicPtr& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~BasicPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        Element* ptr = std::exchange(Ptr(), nullptr);
+        if (ptr == nullptr) {
+            return;
+        }
+        if constexpr (kExternal) {
+            std::exchange(object_.GetSecond().GetFirst(), nullptr)->ReleaseStrong();
+        } else if constexpr (kIntrusive) {
+            ptr->DecRef();
+        } else {
+            ProfileFree(ptr);
+            GetDeleter()(ptr);
+        }
+    }
+    // The new object is taken before the old one is let go, so a counted pointer may be reset
+    // to the object it holds. A unique pointer keeps its deleter, a shared one uses `Deleter()`.
+    void Reset(Element* ptr) {
+        if constexpr (kUnique) {
+            ProfileAlloc(ptr);
+            std::swap(Ptr(), ptr);
+            if (ptr != nullptr) {
+                ProfileFree(ptr);
+                GetDeleter()(ptr);
+            }
+        } else {
+            BasicPtr tmp(ptr);
+            Swap(tmp);
+        }
+    }
+    // Gives up ownership, unique pointers only. The profiler stops tracking the object here:
+    // the caller may free it by hand.
+    Element* Release() {
+        static_assert(kUnique, "Shared ownership can't be released");
+        Element* ptr = Transfer();
+        ProfileFree(ptr);
+        return ptr;
+    }
+    void Swap(BasicPtr& other) {
+        std::swap(Ptr(), other.Ptr());
+        std::swap(object_.GetSecond().GetFirst(), other.object_.GetSecond().GetFirst());
+        std::swap(object_.GetSecond().GetSecond(), other.object_.GetSecond().GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    Element* Get() const {
+        return object_.GetFirst();
+    }
+    template <typename U = T,
+              typename = std::enable_if_t<!std::is_void_v<U> && !std::is_array_v<U>>>
+    U& operator*() const {
+        return *Get();
+    }
+    template <typename U = T,
+              typename = std::enable_if_t<!std::is_void_v<U> && !std::is_array_v<U>>>
+    U* operator->() const {
+        return Get();
+    }
+    template <typename U = T, typename = std::enable_if_t<std::is_array_v<U>>>
+    std::remove_extent_t<U>& operator[](size_t i) const {
+        return Get()[i];
+    }
+    // Unique pointers only: a shared object's deleter is in its block
+    Deleter& GetDeleter() {
+        static_assert(kUnique, "Only unique pointers hold a deleter");
+        return object_.GetSecond().GetSecond();
+    }
+    const Deleter& GetDeleter() const {
+        static_assert(kUnique, "Only unique pointers hold a deleter");
+        return object_.GetSecond().GetSecond();
+    }
+    size_t UseCount() const {
+        if (Get() == nullptr) {
+            return 0;
+        }
+        if constexpr (kExternal) {
+            return BlockPtr()->counter.RefCount();
+        } else if constexpr (kIntrusive) {
+            return Get()->RefCount();
+        } else {
+            return 1;
+        }
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+
+private:
+    Element*& Ptr() {
+        return object_.GetFirst();
+    }
+    CountBlock<Counter>* BlockPtr() const {
+        return object_.GetSecond().GetFirst();
+    }
+    void ClearBlock() {
+        if constexpr (kExternal) {
+            object_.GetSecond().GetFirst() = nullptr;
+        }
+    }
+
+    // Unique pointers report their objects to the profiler, arrays are not sampled
+    static void ProfileAlloc([[maybe_unused]] Element* ptr) {
+        if constexpr (kUnique && !std::is_array_v<T>) {
+            SMART_POINTERS_PROFILE_ALLOC(ptr, ProfiledSize<T>());
+        }
+    }
+    static void ProfileFree([[maybe_unused]] Element* ptr) {
+        if constexpr (kUnique && !std::is_array_v<T>) {
+            SMART_POINTERS_PROFILE_FREE(ptr);
+        }
+    }
+
+    // `Release()` to another owner, the object stays tracked
+    Element* Transfer() {
+        return std::exchange(Ptr(), nullptr);
+    }
+
+    // Takes ownership of a fresh object
+    void Adopt(Element* ptr, Deleter deleter) {
+        if constexpr (kUnique) {
+            GetDeleter() = std::move(deleter);
+        }
+        if (ptr == nullptr) {
+            return;
+        }
+        if constexpr (kExternal) {
+            try {
+                object_.GetSecond().GetFirst() =
+                    new CountBlockFor<Counter, T, Deleter>(ptr, std::move(deleter));
+            } catch (...) {
+                deleter(ptr);
+                throw;
+            }
+            BlockPtr()->counter.IncRef();
+            BlockPtr()->weak.IncRef();
+        } else if constexpr (kIntrusive) {
+            ptr->IncRef();
+        } else {
+            ProfileAlloc(ptr);
+        }
+        Ptr() = ptr;
+    }
+
+    // Counted pointers share the object's own destruction, only unique ones take a deleter
+    template <typename U, typename E>
+    void CopyFrom(const BasicPtr<U, Counting, Counter, E>& other) {
+        Ptr() = other.Get();
+        if (Ptr() == nullptr) {
+            return;
+        }
+        if constexpr (kExternal) {
+            object_.GetSecond().GetFirst() = other.BlockPtr();
+            BlockPtr()->counter.IncRef();
+        } else if constexpr (kIntrusive) {
+            Ptr()->IncRef();
+        }
+    }
+
+    template <typename U, typename E>
+    void MoveFrom(BasicPtr<U, Counting, Counter, E>& other) {
+        Ptr() = other.Transfer();
+        if constexpr (kExternal) {
+            object_.GetSecond().GetFirst() =
+                std::exchange(other.object_.GetSecond().GetFirst(), nullptr);
+        }
+        if constexpr (kUnique) {
+            GetDeleter() = std::move(other.GetDeleter());
+        }
+    }
+
+    CompressedPair<Element*, CompressedPair<Block, StoredDeleter>> object_;
+};
+
+template <typename T, typename U, typename Counting, typename Counter, typename D, typename E>
+inline bool operator==(const BasicPtr<T, Counting, Counter, D>& left,
+                       const BasicPtr<U, Counting, Counter, E>& right) {
+    return left.Get() == right.Get();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Common combinations
+
+template <typename T, typename Counter = SimpleCounter, typename Deleter = Slug<T>>
+using CoreSharedPtr = BasicPtr<T, ExternalCount, Counter, Deleter>;
+
+template <typename T>
+using AtomicSharedPtr = CoreSharedPtr<T, AtomicCounter>;
+
+// Builds the object inside its count block, a single allocation like `MakeShared`
+template <typename T, typename Counter = SimpleCounter, typename... Args>
+CoreSharedPtr<T, Counter> MakeCoreShared(Args&&... args) {
+    auto* block = new CountBlockInplace<Counter, T>(std::forward<Args>(args)...);
+    block->counter.IncRef();
+    block->weak.IncRef();
+    CoreSharedPtr<T, Counter> res;
+    res.Ptr() = block->Object();
+    res.object_.GetSecond().GetFirst() = block;
+    return res;
+}
+
+// `MakeCoreShared` with the object starting on a new cache line, so that threads copying
+// pointers don't contend with threads writing the object. Nothing else is allocated next
+// to the object either; this costs up to two extra lines per object.
+template <typename T, typename Counter = SimpleCounter, typename... Args>
+CoreSharedPtr<T, Counter> MakeCoreSharedPadded(Args&&... args) {
+    constexpr size_t kAlignment = alignof(T) > 64 ? alignof(T) : 64;
+    auto* block = new CountBlockInplace<Counter, T, kAlignment>(std::forward<Args>(args)...);
+    block->counter.IncRef();
+    block->weak.IncRef();
+    CoreSharedPtr<T, Counter> res;
+    res.Ptr() = block->Object();
+    res.object_.GetSecond().GetFirst() = block;
+    return res;
+}
+
+template <typename T, typename... Args>
+AtomicSharedPtr<T> MakeAtomicShared(Args&&... args) {
+    return MakeCoreShared<T, AtomicCounter>(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+AtomicSharedPtr<T> MakeAtomicSharedPadded(Args&&... args) {
+    return MakeCoreSharedPadded<T, AtomicCounter>(std::forward<Args>(args)...);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// BasicWeakPtr
+
+// `WeakPtr` for `BasicPtr<T, ExternalCount, Counter>`. With `AtomicCounter`, `Lock()` may race
+// with the last strong pointer being dropped on another thread.
+template <typename T, typename Counter = SimpleCounter>
+class BasicWeakPtr {
+    template <typename Y, typename N>
+    friend class BasicWeakPtr;
+
+public:
+    using Strong = BasicPtr<T, ExternalCount, Counter>;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    BasicWeakPtr() : ptr_(nullptr), block_(nullptr) {
+    }
+    BasicWeakPtr(std::nullptr_t) : BasicWeakPtr() {
+    }
+
+    template <typename U, typename E,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    BasicWeakPtr(const BasicPtr<U, ExternalCount, Counter, E>& other)
+        : ptr_(other.Get()), block_(other.BlockPtr()) {
+        if (block_ != nullptr) {
+            block_->weak.IncRef();
+        }
+    }
+
+    BasicWeakPtr(const BasicWeakPtr& other) : ptr_(other.ptr_), block_(other.block_) {
+        if (block_ != nullptr) {
+            block_->weak.IncRef();
+        }
+    }
+    BasicWeakPtr(BasicWeakPtr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), block_(std::exchange(other.block_, nullptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    BasicWeakPtr& operator=(BasicWeakPtr other) {
+        Swap(other);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~BasicWeakPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (block_ != nullptr) {
+            block_->ReleaseWeak();
+            ptr_ = nullptr;
+            block_ = nullptr;
+        }
+    }
+    void Swap(BasicWeakPtr& other) {
+        std::swap(ptr_, other.ptr_);
+        std::swap(block_, other.block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t UseCount() const {
+        if (block_ == nullptr) {
+            return 0;
+        }
+        return block_->counter.RefCount();
+    }
+    bool Expired() const {
+        return UseCount() == 0;
+    }
+    // Empty pointer if the object is gone
+    Strong Lock() const {
+        Strong res;
+        if (block_ != nullptr && block_->counter.TryIncRef()) {
+            res.Ptr() = ptr_;
+            res.object_.GetSecond().GetFirst() = block_;
+        }
+        return res;
+    }
+
+private:
+    T* ptr_;
+    CountBlock<Counter>* block_;
+};
+
+template <typename T>
+using AtomicWeakPtr = BasicWeakPtr<T, AtomicCounter>;
+
+static_assert(sizeof(BasicPtr<int, NoCount>) == sizeof(void*));
+static_assert(sizeof(CoreSharedPtr<int>) == 2 * sizeof(void*));
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // size_t
+
+// Reference counters, used by `RefCounted` and as the `Counter` policy of `BasicPtr`.
+
+class SimpleCounter {
+public:
+    SimpleCounter() = default;
+    ~SimpleCounter() = default;
+
+    SimpleCounter(const SimpleCounter&) = default;
+    SimpleCounter(SimpleCounter&&) = default;
+
+    SimpleCounter& operator=(const SimpleCounter&) {
+        return *this;
+    }
+    SimpleCounter& operator=(SimpleCounter&&) {
+        return *this;
+    }
+
+    size_t IncRef() {
+        return ++count_;
+    }
+    size_t DecRef() {
+        return --count_;
+    }
+    // Increments unless the count is already zero
+    bool TryIncRef() {
+        if (count_ == 0) {
+            return false;
+        }
+        ++count_;
+        return true;
+    }
+    size_t RefCount() const {
+        return count_;
+    }
+
+private:
+    size_t count_ = 0;
+};
+
+// Same as `SimpleCounter`, but safe to share between threads.
+class AtomicCounter {
+public:
+    AtomicCounter() = default;
+    ~AtomicCounter() = default;
+
+    // A copied object starts with its own count
+    AtomicCounter(const AtomicCounter&) {
+    }
+    AtomicCounter& operator=(const AtomicCounter&) {
+        return *this;
+    }
+
+    size_t IncRef() {
+        return count_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    size_t DecRef() {
+        return count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    }
+    // Increments unless the count is already zero
+    bool TryIncRef() {
+        size_t cur = count_.load(std::memory_order_relaxed);
+        while (cur != 0) {
+            if (count_.compare_exchange_weak(cur, cur + 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    size_t RefCount() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> count_{0};
+};
+
+// `Counter` on a cache line of its own. With a shared atomic counter this stops pointer
+// copies on other threads from invalidating the line holding the object's data:
+// `RefCounted<Derived, PaddedCounter<AtomicCounter>, D>`. Costs up to a cache line per object.
+template <typename Counter>
+struct alignas(64) PaddedCounter : Counter {};
+
+static_assert(sizeof(PaddedCounter<SimpleCounter>) == 64);
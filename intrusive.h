@@ -1,37 +1,12 @@
 #pragma once
 
+#include "core.h"
+#include "counters.h"
+#include "profiler.h"
+
 #include <cstddef>  // for std::nullptr_t
 #include <utility>  // for std::exchange / std::swap
 
-class SimpleCounter {
-public:
-    SimpleCounter() = default;
-    ~SimpleCounter() = default;
-
-    SimpleCounter(const SimpleCounter&) = default;
-    SimpleCounter(SimpleCounter&&) = default;
-
-    SimpleCounter& operator=(const SimpleCounter&) {
-        return *this;
-    }
-    SimpleCounter& operator=(SimpleCounter&&) {
-        return *this;
-    }
-
-    size_t IncRef() {
-        return ++count_;
-    }
-    size_t DecRef() {
-        return --count_;
-    }
-    size_t RefCount() const {
-        return count_;
-    }
-
-private:
-    size_t count_ = 0;
-};
-
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
@@ -51,6 +26,7 @@ public:
     // Destroy object using Deleter when the last instance dies.
     void DecRef() {
         if (counter_.DecRef() == 0) {
+            SMART_POINTERS_PROFILE_FREE(static_cast<Derived*>(this));
             Deleter::Destroy(static_cast<Derived*>(this));
         }
     }
@@ -67,116 +43,17 @@ private:
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
 
+// Shares an object that counts its own references, e.g. one derived from `RefCounted`.
+// `Reset(ptr)` and construction from a raw pointer add a reference, so an object may be
+// handed from one `IntrusivePtr` to another as a plain pointer.
 template <typename T>
-class IntrusivePtr {
-    template <typename Y>
-    friend class IntrusivePtr;
-
-public:
-    // Constructors
-    IntrusivePtr() {
-        ptr_ = nullptr;
-    }
-    IntrusivePtr(std::nullptr_t) : IntrusivePtr() {
-    }
-    IntrusivePtr(T* ptr) : ptr_(ptr) {
-        if (ptr_) {
-            ptr_->IncRef();
-        }
-    }
-
-    template <typename Y>
-    IntrusivePtr(const IntrusivePtr<Y>& other) : ptr_(other.ptr_) {
-        if (ptr_) {
-            ptr_->IncRef();
-        }
-    }
-
-    template <typename Y>
-    IntrusivePtr(IntrusivePtr<Y>&& other) : ptr_(other.ptr_) {
-        other.ptr_ = nullptr;
-    }
-
-    IntrusivePtr(const IntrusivePtr& other) : ptr_(other.ptr_) {
-        if (ptr_) {
-            ptr_->IncRef();
-        }
-    }
-    IntrusivePtr(IntrusivePtr&& other) : ptr_(other.ptr_) {
-        other.ptr_ = nullptr;
-    }
-
-    // `operator=`-s
-    IntrusivePtr& operator=(const IntrusivePtr& other) {
-        if (ptr_ == other.ptr_) {
-            return *this;
-        }
-        Reset();
-        ptr_ = other.ptr_;
-        if (ptr_) {
-            ptr_->IncRef();
-        }
-        return *this;
-    }
-    IntrusivePtr& operator=(IntrusivePtr&& other) {
-        if (this == &other) {
-            return *this;
-        }
-        Reset();
-        ptr_ = other.ptr_;
-        other.ptr_ = nullptr;
-        return *this;
-    }
-
-    // Destructor
-    ~IntrusivePtr() {
-        Reset();
-    }
-
-    // Modifiers
-    void Reset() {
-        if (ptr_) {
-            ptr_->DecRef();
-        }
-        ptr_ = nullptr;
-    }
-    void Reset(T* ptr) {
-        if (ptr) {
-            ptr->IncRef();
-        }
-        Reset();
-        ptr_ = ptr;
-    }
-    void Swap(IntrusivePtr& other) {
-        std::swap(ptr_, other.ptr_);
-    }
-
-    // Observers
-    T* Get() const {
-        return ptr_;
-    }
-    T& operator*() const {
-        return *ptr_;
-    }
-    T* operator->() const {
-        return ptr_;
-    }
-    size_t UseCount() const {
-        if (!ptr_) {
-            return 0;
-        }
-        return ptr_->RefCount();
-    }
-    explicit operator bool() const {
-        return ptr_ != nullptr;
-    }
-
-private:
-    T* ptr_;
-};
+using IntrusivePtr = BasicPtr<T, IntrusiveCount>;
 
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
     T* raw = new T(std::forward<Args>(args)...);
+    SMART_POINTERS_PROFILE_ALLOC(raw, sizeof(T));
     return IntrusivePtr<T>(raw);
 }
+
+static_assert(sizeof(IntrusivePtr<SimpleRefCounted<int>>) == sizeof(void*));
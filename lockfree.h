@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <memory>  // std::unique_ptr
+#include <new>
+#include <utility>
+
+// Lock-free containers for passing owning pointers (`SharedPtr`, `IntrusivePtr`,
+// `UniquePtr`) between threads. Elements are only ever moved in and moved out,
+// so ownership is transferred without touching reference counters.
+//
+// Both containers are bounded and preallocate all their slots: memory is never
+// returned while the container is alive, which sidesteps the reclamation problem,
+// and the stack tags its heads against ABA.
+
+// Bounded multi-producer multi-consumer FIFO queue (D. Vyukov's design).
+template <typename T>
+class MpmcQueue {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    // `capacity` is rounded up to a power of two.
+    explicit MpmcQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue& other) = delete;
+    MpmcQueue& operator=(const MpmcQueue& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    // No thread uses the queue any more, so the elements are destroyed where they are:
+    // `T` need not be default constructible.
+    ~MpmcQueue() {
+        size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+        for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos) {
+            reinterpret_cast<T*>(cells_[pos & mask_].storage)->~T();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Moves `value` into the queue. Leaves `value` untouched and returns false if full.
+    bool TryPush(T&& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void*>(cell->storage)) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Moves the oldest element into `out`. Returns false if empty.
+    bool TryPop(T& out) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* obj = reinterpret_cast<T*>(cell->storage);
+        out = std::move(*obj);
+        obj->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // Producers and consumers hammer different counters, keep them on different lines.
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+// Bounded Treiber stack. Nodes live in a preallocated array and are linked by index;
+// each head packs a 32-bit index with a 32-bit modification tag, so a node that was
+// popped and pushed back in between can't fool a stale CAS.
+template <typename T>
+class TreiberStack {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit TreiberStack(uint32_t capacity) : nodes_(new Node[capacity]) {
+        for (uint32_t i = 0; i < capacity; ++i) {
+            nodes_[i].next.store(i + 1 < capacity ? i + 1 : kNil, std::memory_order_relaxed);
+        }
+        head_.store(Pack(kNil, 0), std::memory_order_relaxed);
+        free_.store(Pack(capacity > 0 ? 0 : kNil, 0), std::memory_order_relaxed);
+    }
+
+    TreiberStack(const TreiberStack& other) = delete;
+    TreiberStack& operator=(const TreiberStack& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    // Destroys the elements in place, as `~MpmcQueue` does
+    ~TreiberStack() {
+        uint32_t index = Index(head_.load(std::memory_order_relaxed));
+        while (index != kNil) {
+            reinterpret_cast<T*>(nodes_[index].storage)->~T();
+            index = nodes_[index].next.load(std::memory_order_relaxed);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Moves `value` onto the stack. Leaves `value` untouched and returns false if full.
+    bool TryPush(T&& value) {
+        uint32_t index = PopIndex(free_);
+        if (index == kNil) {
+            return false;
+        }
+        ::new (static_cast<void*>(nodes_[index].storage)) T(std::move(value));
+        PushIndex(head_, index);
+        return true;
+    }
+
+    // Moves the top element into `out`. Returns false if empty.
+    bool TryPop(T& out) {
+        uint32_t index = PopIndex(head_);
+        if (index == kNil) {
+            return false;
+        }
+        T* obj = reinterpret_cast<T*>(nodes_[index].storage);
+        out = std::move(*obj);
+        obj->~T();
+        PushIndex(free_, index);
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFF;
+
+    struct Node {
+        std::atomic<uint32_t> next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static uint64_t Pack(uint32_t index, uint32_t tag) {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+    static uint32_t Index(uint64_t head) {
+        return static_cast<uint32_t>(head);
+    }
+    static uint32_t Tag(uint64_t head) {
+        return static_cast<uint32_t>(head >> 32);
+    }
+
+    uint32_t PopIndex(std::atomic<uint64_t>& head) {
+        uint64_t old = head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = Index(old);
+            if (index == kNil) {
+                return kNil;
+            }
+            // `next` may be stale if the node was recycled meanwhile, the tag catches that.
+            uint32_t next = nodes_[index].next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old, Pack(next, Tag(old) + 1),
+                                           std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    void PushIndex(std::atomic<uint64_t>& head, uint32_t index) {
+        uint64_t old = head.load(std::memory_order_relaxed);
+        do {
+            nodes_[index].next.store(Index(old), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(old, Pack(index, Tag(old) + 1),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    std::unique_ptr<Node[]> nodes_;
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> free_;
+};
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "Shared/shared.h"
+#include "Unique/unique.h"
+#include "intrusive.h"
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+// Owning pointers that are never null. The invariant is checked once, when a nullable
+// pointer is adopted, so copies and destructors touch the counter without a null check.
+//
+// Shared pointers have no moved-from state: moving `NonNullShared`/`NonNullIntrusive` copies
+// (one extra increment and decrement). Use the nullable pointers where ownership has to be
+// handed over cheaply. `NonNullUnique` can't copy, so it moves; a moved-from one is empty
+// and may only be destroyed or assigned to.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SMART_POINTERS_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define SMART_POINTERS_NOINLINE __declspec(noinline)
+#else
+#define SMART_POINTERS_NOINLINE
+#endif
+
+// Thrown when a null pointer is adopted
+class NullPointerError : public std::exception {};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// NonNullShared
+
+template <typename T>
+class NonNullShared {
+    template <typename Y>
+    friend class NonNullShared;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    // Takes over the reference of `ptr`. An alias of an empty pointer owns nothing and is
+    // rejected as well.
+    explicit NonNullShared(SharedPtr<T> ptr) {
+        if (!ptr || ptr.block_ == nullptr) {
+            throw NullPointerError{};
+        }
+        ptr_ = std::exchange(ptr.ptr_, nullptr);
+        block_ = std::exchange(ptr.block_, nullptr);
+    }
+
+    NonNullShared(const NonNullShared& other) : ptr_(other.ptr_), block_(other.block_) {
+        block_->IncStr();
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NonNullShared(const NonNullShared<U>& other) : ptr_(other.ptr_), block_(other.block_) {
+        block_->IncStr();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    NonNullShared& operator=(NonNullShared other) {
+        Swap(other);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~NonNullShared() {
+        block_->DecStr();
+        if (block_->strong == 0) {
+            Destroy(block_);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Swap(NonNullShared& other) {
+        std::swap(ptr_, other.ptr_);
+        std::swap(block_, other.block_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_;
+    }
+    T& operator*() const {
+        return *ptr_;
+    }
+    T* operator->() const {
+        return ptr_;
+    }
+    size_t UseCount() const {
+        return block_->strong;
+    }
+
+    // Nullable copy
+    SharedPtr<T> ToShared() const {
+        SharedPtr<T> res;
+        block_->IncStr();
+        res.ptr_ = ptr_;
+        res.block_ = block_;
+        return res;
+    }
+    operator SharedPtr<T>() const {
+        return ToShared();
+    }
+
+private:
+    // Kept out of line, so that the destructor inlines to a decrement and a compare
+    SMART_POINTERS_NOINLINE static void Destroy(ControlBlockBase* block) noexcept {
+        block->DestroyObject();
+        block->ReleaseWeak();
+    }
+
+    T* ptr_;
+    ControlBlockBase* block_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const NonNullShared<T>& left, const NonNullShared<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+NonNullShared<T> MakeNonNullShared(Args&&... args) {
+    return NonNullShared<T>(MakeShared<T>(std::forward<Args>(args)...));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// NonNullIntrusive
+
+template <typename T>
+class NonNullIntrusive {
+    template <typename Y>
+    friend class NonNullIntrusive;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit NonNullIntrusive(T* ptr) : ptr_(Check(ptr)) {
+        ptr_->IncRef();
+    }
+    explicit NonNullIntrusive(const IntrusivePtr<T>& ptr) : NonNullIntrusive(ptr.Get()) {
+    }
+
+    NonNullIntrusive(const NonNullIntrusive& other) : ptr_(other.ptr_) {
+        ptr_->IncRef();
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NonNullIntrusive(const NonNullIntrusive<U>& other) : ptr_(other.ptr_) {
+        ptr_->IncRef();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    NonNullIntrusive& operator=(NonNullIntrusive other) {
+        Swap(other);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~NonNullIntrusive() {
+        ptr_->DecRef();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Swap(NonNullIntrusive& other) {
+        std::swap(ptr_, other.ptr_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_;
+    }
+    T& operator*() const {
+        return *ptr_;
+    }
+    T* operator->() const {
+        return ptr_;
+    }
+    size_t UseCount() const {
+        return ptr_->RefCount();
+    }
+
+    IntrusivePtr<T> ToIntrusive() const {
+        return IntrusivePtr<T>(ptr_);
+    }
+    operator IntrusivePtr<T>() const {
+        return ToIntrusive();
+    }
+
+private:
+    static T* Check(T* ptr) {
+        if (ptr == nullptr) {
+            throw NullPointerError{};
+        }
+        return ptr;
+    }
+
+    T* ptr_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const NonNullIntrusive<T>& left, const NonNullIntrusive<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+NonNullIntrusive<T> MakeNonNullIntrusive(Args&&... args) {
+    return NonNullIntrusive<T>(MakeIntrusive<T>(std::forward<Args>(args)...));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// NonNullUnique
+
+// Only the destructor of a moved-from pointer checks for null.
+template <typename T, typename Deleter = Slug<T>>
+class NonNullUnique {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit NonNullUnique(UniquePtr<T, Deleter>&& ptr) {
+        if (!ptr) {
+            throw NullPointerError{};
+        }
+        object_.GetSecond() = std::move(ptr.GetDeleter());
+        object_.GetFirst() = ptr.Transfer();
+    }
+
+    NonNullUnique(const NonNullUnique& other) = delete;
+    NonNullUnique(NonNullUnique&& other) noexcept {
+        object_.GetSecond() = std::move(other.object_.GetSecond());
+        object_.GetFirst() = std::exchange(other.object_.GetFirst(), nullptr);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    NonNullUnique& operator=(const NonNullUnique& other) = delete;
+    NonNullUnique& operator=(NonNullUnique&& other) noexcept {
+        NonNullUnique tmp(std::move(other));
+        Swap(tmp);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~NonNullUnique() {
+        if (object_.GetFirst() != nullptr) {
+            SMART_POINTERS_PROFILE_FREE(object_.GetFirst());
+            object_.GetSecond()(object_.GetFirst());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Swap(NonNullUnique& other) {
+        std::swap(object_.GetFirst(), other.object_.GetFirst());
+        std::swap(object_.GetSecond(), other.object_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return object_.GetFirst();
+    }
+    T& operator*() const {
+        return *object_.GetFirst();
+    }
+    T* operator->() const {
+        return object_.GetFirst();
+    }
+    Deleter& GetDeleter() {
+        return object_.GetSecond();
+    }
+    const Deleter& GetDeleter() const {
+        return object_.GetSecond();
+    }
+
+private:
+    CompressedPair<T*, Deleter> object_;
+};
+
+template <typename T, typename... Args>
+NonNullUnique<T> MakeNonNullUnique(Args&&... args) {
+    return NonNullUnique<T>(UniquePtr<T>(new T(std::forward<Args>(args)...)));
+}
+
+static_assert(sizeof(NonNullUnique<int>) == sizeof(void*));
+static_assert(sizeof(NonNullIntrusive<SimpleRefCounted<int>>) == sizeof(void*));
@@ -0,0 +1,254 @@
+#pragma once
+
+// Sampling lifetime profiler for managed objects, compiled in with -DSMART_POINTERS_PROFILE.
+// Without it the hooks below expand to nothing.
+//
+// Allocations made by `MakeShared`, `SharedPtr(U*)`, `MakeIntrusive` and `UniquePtr` are
+// sampled about once per `SampleInterval()` bytes. A sampled object records its creation
+// stack and time; when it is destroyed its lifetime goes to a log2 histogram of its
+// allocation site. `WriteText` dumps the sites, most sampled first: short-lived sites are
+// candidates for stack or arena allocation.
+//
+// Samples are keyed by the address of the complete object, so an object allocated as
+// `Derived` and destroyed through a `Base*` at a non-zero offset (a `UniquePtr<Derived>`
+// moved into a `UniquePtr<Base>`, say) still closes its sample. Finding it needs
+// a polymorphic type; deleting such an object through a non-polymorphic base is undefined
+// anyway.
+
+#include <cstddef>  // size_t
+#include <type_traits>
+
+// Size an allocation hook reports for `T`, zero for `void`.
+template <typename T>
+constexpr size_t ProfiledSize() {
+    if constexpr (std::is_void_v<T>) {
+        return 0;
+    } else {
+        return sizeof(T);
+    }
+}
+
+#ifdef SMART_POINTERS_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>  // free
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define SMART_POINTERS_HAS_BACKTRACE 1
+#else
+#define SMART_POINTERS_HAS_BACKTRACE 0
+#endif
+
+class LifetimeProfiler {
+public:
+    static constexpr size_t kMaxFrames = 32;
+    static constexpr size_t kBuckets = 64;
+    static constexpr size_t kFilterSize = 1 << 14;
+
+    static LifetimeProfiler& Instance() {
+        static LifetimeProfiler profiler;
+        return profiler;
+    }
+
+    // Mean number of bytes between two samples, 1 samples everything.
+    size_t SampleInterval() const {
+        return interval_.load(std::memory_order_relaxed);
+    }
+    void SetSampleInterval(size_t bytes) {
+        interval_.store(bytes == 0 ? 1 : bytes, std::memory_order_relaxed);
+    }
+
+    void OnAlloc(const void* obj, size_t bytes) {
+        if (obj == nullptr || !ShouldSample(bytes)) {
+            return;
+        }
+        Sample sample;
+        sample.bytes = bytes;
+        sample.start = std::chrono::steady_clock::now();
+#if SMART_POINTERS_HAS_BACKTRACE
+        void* frames[kMaxFrames];
+        int depth = ::backtrace(frames, kMaxFrames);
+        // Skip this function
+        sample.stack.assign(frames + (depth > 1 ? 1 : 0), frames + depth);
+#endif
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (live_.insert_or_assign(obj, std::move(sample)).second) {
+            FilterSlot(obj).fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void OnFree(const void* obj) {
+        // Almost no object is sampled: the filter rules them out without taking the lock
+        if (obj == nullptr || FilterSlot(obj).load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = live_.find(obj);
+        if (it == live_.end()) {
+            return;
+        }
+        FilterSlot(obj).fetch_sub(1, std::memory_order_relaxed);
+        Sample& sample = it->second;
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             end - sample.start).count();
+        Site& site = sites_[sample.stack];
+        ++site.samples;
+        site.bytes += sample.bytes;
+        ++site.histogram[Bucket(nanos)];
+        live_.erase(it);
+    }
+
+    // Per-site report: sample count, sampled bytes, lifetime histogram (ns, log2 buckets)
+    // and the symbolized allocation stack.
+    void WriteText(std::ostream& out) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        std::vector<const std::pair<const Stack, Site>*> order;
+        for (const auto& entry : sites_) {
+            order.push_back(&entry);
+        }
+        std::sort(order.begin(), order.end(), [](auto* left, auto* right) {
+            return left->second.samples > right->second.samples;
+        });
+        out << "sample interval: " << SampleInterval() << " bytes\n";
+        for (const auto* entry : order) {
+            const Site& site = entry->second;
+            out << "\nsite: " << site.samples << " samples, " << site.bytes << " bytes\n";
+            for (size_t i = 0; i < kBuckets; ++i) {
+                if (site.histogram[i] != 0) {
+                    out << "  < 2^" << i << " ns: " << site.histogram[i] << "\n";
+                }
+            }
+            WriteStack(out, entry->first);
+        }
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto& entry : live_) {
+            FilterSlot(entry.first).fetch_sub(1, std::memory_order_relaxed);
+        }
+        live_.clear();
+        sites_.clear();
+    }
+
+private:
+    using Stack = std::vector<void*>;
+
+    struct StackHash {
+        size_t operator()(const Stack& stack) const {
+            size_t hash = 0;
+            for (void* frame : stack) {
+                hash = hash * 31 + std::hash<void*>{}(frame);
+            }
+            return hash;
+        }
+    };
+
+    struct Sample {
+        size_t bytes;
+        std::chrono::steady_clock::time_point start;
+        Stack stack;
+    };
+
+    struct Site {
+        uint64_t samples = 0;
+        uint64_t bytes = 0;
+        uint64_t histogram[kBuckets] = {};
+    };
+
+    LifetimeProfiler() = default;
+
+    // Sampling points are exponentially distributed over allocated bytes, so
+    // every byte has the same chance to be sampled regardless of object size.
+    bool ShouldSample(size_t bytes) {
+        thread_local std::minstd_rand random(std::random_device{}());
+        thread_local size_t interval = 0;
+        thread_local int64_t until_sample = 0;
+        // Redraw right away when the interval changes, not at the next sample
+        if (interval != SampleInterval()) {
+            interval = SampleInterval();
+            until_sample = NextSampleDistance(random);
+        }
+        if (interval == 1) {
+            return true;
+        }
+        until_sample -= static_cast<int64_t>(bytes == 0 ? 1 : bytes);
+        if (until_sample > 0) {
+            return false;
+        }
+        until_sample = NextSampleDistance(random);
+        return true;
+    }
+    int64_t NextSampleDistance(std::minstd_rand& random) const {
+        std::exponential_distribution<double> next(1.0 / static_cast<double>(SampleInterval()));
+        return static_cast<int64_t>(next(random)) + 1;
+    }
+
+    // Number of live samples per address hash. Updated under `mutex_`, read without it.
+    std::atomic<uint32_t>& FilterSlot(const void* obj) {
+        // Drop the low bits, they are mostly zero due to alignment
+        size_t hash = std::hash<uintptr_t>{}(reinterpret_cast<uintptr_t>(obj) >> 4);
+        return filter_[(hash ^ (hash >> 14)) % kFilterSize];
+    }
+
+    static size_t Bucket(uint64_t nanos) {
+        size_t bucket = 0;
+        while (nanos > 0 && bucket + 1 < kBuckets) {
+            nanos >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    static void WriteStack(std::ostream& out, const Stack& stack) {
+#if SMART_POINTERS_HAS_BACKTRACE
+        char** symbols = ::backtrace_symbols(stack.data(), static_cast<int>(stack.size()));
+        for (size_t i = 0; i < stack.size(); ++i) {
+            out << "    " << (symbols ? symbols[i] : "?") << "\n";
+        }
+        ::free(symbols);
+#else
+        for (void* frame : stack) {
+            out << "    " << frame << "\n";
+        }
+#endif
+    }
+
+    std::atomic<size_t> interval_{512 * 1024};
+    std::atomic<uint32_t> filter_[kFilterSize] = {};
+    std::mutex mutex_;
+    std::unordered_map<const void*, Sample> live_;
+    std::unordered_map<Stack, Site, StackHash> sites_;
+};
+
+// Address of the complete object `obj` is part of
+template <typename T>
+const void* ProfiledAddress(const T* obj) {
+    if constexpr (std::is_polymorphic_v<T>) {
+        return obj == nullptr ? nullptr : dynamic_cast<const void*>(obj);
+    } else {
+        return static_cast<const void*>(obj);
+    }
+}
+
+#define SMART_POINTERS_PROFILE_ALLOC(obj, bytes) \
+    LifetimeProfiler::Instance().OnAlloc(ProfiledAddress(obj), (bytes))
+#define SMART_POINTERS_PROFILE_FREE(obj) LifetimeProfiler::Instance().OnFree(ProfiledAddress(obj))
+
+#else
+
+#define SMART_POINTERS_PROFILE_ALLOC(obj, bytes) ((void)0)
+#define SMART_POINTERS_PROFILE_FREE(obj) ((void)0)
+
+#endif
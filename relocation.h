@@ -0,0 +1,283 @@
+#pragma once
+
+#include "Shared/shared.h"
+#include "Shared/weak.h"
+#include "Unique/deleters.h"
+#include "Unique/unique.h"
+#include "intrusive.h"
+#include "non_null.h"
+#include "tagged.h"
+
+#include <cstddef>  // size_t
+#include <cstring>  // std::memmove
+#include <memory>   // std::allocator
+#include <new>
+#include <type_traits>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Trivial relocation
+
+// A type is trivially relocatable if moving an object to a new address and destroying
+// the source is the same as copying its bytes. Every smart pointer here is just a pointer
+// word (plus a deleter), so it qualifies; `OffsetPtr` and `PolyValue` don't, they point
+// into themselves.
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
+
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<NonNullShared<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<NonNullIntrusive<T>> : std::true_type {};
+
+template <typename T, size_t Bits, TagPlacement Placement>
+struct IsTriviallyRelocatable<TaggedIntrusivePtr<T, Bits, Placement>> : std::true_type {};
+
+// `UniquePtr` is as relocatable as its deleter
+template <typename T, typename D>
+struct IsTriviallyRelocatable<UniquePtr<T, D>> : IsTriviallyRelocatable<D> {};
+
+template <typename T, typename D, size_t Bits, TagPlacement Placement>
+struct IsTriviallyRelocatable<TaggedUniquePtr<T, D, Bits, Placement>>
+    : IsTriviallyRelocatable<D> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<Slug<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<Deleter<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<CopyableDeleter<T>> : std::true_type {};
+
+// Moves `count` objects from `src` to uninitialized `dst` and ends the lifetime of the sources.
+// The ranges may overlap.
+template <typename T>
+void Relocate(T* dst, T* src, size_t count) noexcept {
+    if (count == 0 || dst == src) {
+        return;
+    }
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        std::memmove(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+    } else {
+        static_assert(std::is_nothrow_move_constructible_v<T>);
+        if (dst < src) {
+            for (size_t i = 0; i < count; ++i) {
+                ::new (static_cast<void*>(dst + i)) T(std::move(src[i]));
+                src[i].~T();
+            }
+        } else {
+            for (size_t i = count; i > 0; --i) {
+                ::new (static_cast<void*>(dst + i - 1)) T(std::move(src[i - 1]));
+                src[i - 1].~T();
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// RelocVector
+
+// Vector that grows, inserts and erases by relocation: for trivially relocatable types
+// elements are shifted with a single `memmove` instead of a move + destroy per element.
+template <typename T>
+class RelocVector {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    RelocVector() = default;
+
+    // Delegates to the default constructor, so that the destructor cleans up if a copy throws
+    RelocVector(const RelocVector& other) : RelocVector() {
+        Reserve(other.size_);
+        for (size_t i = 0; i < other.size_; ++i) {
+            ::new (static_cast<void*>(data_ + i)) T(other.data_[i]);
+            ++size_;
+        }
+    }
+    RelocVector(RelocVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    RelocVector& operator=(const RelocVector& other) {
+        if (this == &other) {
+            return *this;
+        }
+        RelocVector copy(other);
+        Swap(copy);
+        return *this;
+    }
+    RelocVector& operator=(RelocVector&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        RelocVector tmp(std::move(other));
+        Swap(tmp);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~RelocVector() {
+        Clear();
+        std::allocator<T>().deallocate(data_, capacity_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        T* data = std::allocator<T>().allocate(capacity);
+        Relocate(data, data_, size_);
+        std::allocator<T>().deallocate(data_, capacity_);
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ < capacity_) {
+            T* obj = ::new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+            ++size_;
+            return *obj;
+        }
+        // `args` may refer to an element: build the new one before the old buffer is freed
+        size_t capacity = NextCapacity();
+        T* data = std::allocator<T>().allocate(capacity);
+        T* obj;
+        try {
+            obj = ::new (static_cast<void*>(data + size_)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            std::allocator<T>().deallocate(data, capacity);
+            throw;
+        }
+        Relocate(data, data_, size_);
+        std::allocator<T>().deallocate(data_, capacity_);
+        data_ = data;
+        capacity_ = capacity;
+        ++size_;
+        return *obj;
+    }
+    void PushBack(const T& value) {
+        EmplaceBack(value);
+    }
+    void PushBack(T&& value) {
+        EmplaceBack(std::move(value));
+    }
+    void PopBack() {
+        --size_;
+        data_[size_].~T();
+    }
+
+    // Constructs an element at `index`, shifting the tail right.
+    template <typename... Args>
+    T& Emplace(size_t index, Args&&... args) {
+        // Build the element first: `args` may refer to elements of this vector
+        T value(std::forward<Args>(args)...);
+        Grow();
+        Relocate(data_ + index + 1, data_ + index, size_ - index);
+        T* obj = ::new (static_cast<void*>(data_ + index)) T(std::move(value));
+        ++size_;
+        return *obj;
+    }
+    void Insert(size_t index, const T& value) {
+        Emplace(index, value);
+    }
+    void Insert(size_t index, T&& value) {
+        Emplace(index, std::move(value));
+    }
+
+    // Destroys the element at `index`, shifting the tail left.
+    void Erase(size_t index) {
+        data_[index].~T();
+        Relocate(data_ + index, data_ + index + 1, size_ - index - 1);
+        --size_;
+    }
+
+    void Clear() {
+        for (size_t i = size_; i > 0; --i) {
+            data_[i - 1].~T();
+        }
+        size_ = 0;
+    }
+    void Swap(RelocVector& other) {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return size_;
+    }
+    size_t Capacity() const {
+        return capacity_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+    T* Data() {
+        return data_;
+    }
+    const T* Data() const {
+        return data_;
+    }
+    T& operator[](size_t i) {
+        return data_[i];
+    }
+    const T& operator[](size_t i) const {
+        return data_[i];
+    }
+
+    T* begin() {
+        return data_;
+    }
+    T* end() {
+        return data_ + size_;
+    }
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    size_t NextCapacity() const {
+        return capacity_ == 0 ? 4 : 2 * capacity_;
+    }
+    void Grow() {
+        if (size_ == capacity_) {
+            Reserve(NextCapacity());
+        }
+    }
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
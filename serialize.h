@@ -0,0 +1,345 @@
+#pragma once
+
+#include "Shared/shared.h"
+#include "intrusive.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Binary archives for object graphs held by `SharedPtr`/`IntrusivePtr`.
+// Every shared object is written once, on its first reference; later references write
+// only its id, so loading rebuilds exactly the same sharing (cycles included).
+// Object bodies don't nest: a newly referenced object is queued and written after the body
+// that references it, so a long list is walked iteratively instead of recursing per node.
+// A `SharedPtr` is identified by its control block, as in `operator==`, an `IntrusivePtr`
+// by the object itself.
+//
+// Trivially copyable values are stored as raw bytes, other types provide
+//     void Save(OutputArchive& archive, const T& value);
+//     void Load(InputArchive& archive, T& value);
+// found by ADL. Loaded objects are default constructed with `MakeShared`/`MakeIntrusive`
+// and filled in after the `Load` that read the pointer returns, so a `Load` must not look
+// into the objects it reads pointers to. Pointers keep their static type: a `SharedPtr<Base>`
+// to a derived object and aliasing pointers are not supported, and a back-reference
+// must be read as the same pointer type it was first read as.
+//
+// Malformed input (bad ids, type mismatches, truncated data) throws `ArchiveError`.
+
+class ArchiveError : public std::exception {};
+
+class OutputArchive {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit OutputArchive(std::ostream& out) : out_(out) {
+    }
+
+    OutputArchive(const OutputArchive& other) = delete;
+    OutputArchive& operator=(const OutputArchive& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Writers
+
+    void WriteBytes(const void* data, size_t size) {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!out_) {
+            throw ArchiveError{};
+        }
+    }
+
+    template <typename T>
+    void Write(const T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            WriteBytes(&value, sizeof(T));
+        } else {
+            Save(*this, value);
+        }
+    }
+    void Write(const std::string& value) {
+        Write(static_cast<uint64_t>(value.size()));
+        WriteBytes(value.data(), value.size());
+    }
+    template <typename T>
+    void Write(const std::vector<T>& values) {
+        Write(static_cast<uint64_t>(values.size()));
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            WriteBytes(values.data(), values.size() * sizeof(T));
+        } else {
+            for (const T& value : values) {
+                Write(value);
+            }
+        }
+    }
+
+    template <typename T>
+    void Write(const SharedPtr<T>& ptr) {
+        assert((ptr.block_ == nullptr || ptr.Get() == ptr.block_->GetObj()) &&
+               "Aliasing pointers can't be serialized");
+        WriteObject(ptr.block_, ptr.Get());
+    }
+    template <typename T>
+    void Write(const IntrusivePtr<T>& ptr) {
+        WriteObject(ptr.Get(), ptr.Get());
+    }
+
+private:
+    // Object whose body is still to be written
+    struct Pending {
+        const void* obj;
+        void (*write)(OutputArchive& archive, const void* obj);
+    };
+
+    template <typename T>
+    static void WriteBody(OutputArchive& archive, const void* obj) {
+        archive.Write(*static_cast<const T*>(obj));
+    }
+
+    // Writes the id of `identity`, queueing the object itself on its first occurrence.
+    // The outermost call writes the queued bodies.
+    template <typename T>
+    void WriteObject(const void* identity, const T* obj) {
+        if (identity == nullptr) {
+            Write(uint64_t{0});
+            return;
+        }
+        auto [it, inserted] = ids_.emplace(identity, ids_.size() + 1);
+        Write(it->second);
+        if (inserted) {
+            pending_.push_back({obj, &WriteBody<T>});
+        }
+        if (!writing_pending_) {
+            WritePending();
+        }
+    }
+
+    void WritePending() {
+        writing_pending_ = true;
+        try {
+            while (!pending_.empty()) {
+                Pending next = pending_.front();
+                pending_.pop_front();
+                next.write(*this, next.obj);
+            }
+        } catch (...) {
+            writing_pending_ = false;
+            pending_.clear();
+            throw;
+        }
+        writing_pending_ = false;
+    }
+
+    std::ostream& out_;
+    std::unordered_map<const void*, uint64_t> ids_;
+    std::deque<Pending> pending_;
+    bool writing_pending_ = false;
+};
+
+class InputArchive {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit InputArchive(std::istream& in) : in_(in) {
+    }
+
+    InputArchive(const InputArchive& other) = delete;
+    InputArchive& operator=(const InputArchive& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    // The archive keeps every loaded object alive until it is done, so that later
+    // references to it can still be resolved.
+    ~InputArchive() {
+        for (Entry& entry : objects_) {
+            entry.release(entry.obj, entry.block);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Readers
+
+    void ReadBytes(void* data, size_t size) {
+        in_.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+        if (!in_) {
+            throw ArchiveError{};
+        }
+    }
+
+    template <typename T>
+    void Read(T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            ReadBytes(&value, sizeof(T));
+        } else {
+            Load(*this, value);
+        }
+    }
+    // Sizes come from the input, so containers grow as their data arrives: a corrupt size
+    // runs out of input instead of allocating all of it up front.
+    void Read(std::string& value) {
+        size_t size = ReadSize(value.max_size());
+        value.clear();
+        while (value.size() < size) {
+            size_t offset = value.size();
+            size_t chunk = std::min(size - offset, kReadChunk);
+            value.resize(offset + chunk);
+            ReadBytes(value.data() + offset, chunk);
+        }
+    }
+    template <typename T>
+    void Read(std::vector<T>& values) {
+        size_t size = ReadSize(values.max_size());
+        size_t chunk_size = std::max<size_t>(kReadChunk / sizeof(T), 1);
+        values.clear();
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            while (values.size() < size) {
+                size_t offset = values.size();
+                size_t chunk = std::min(size - offset, chunk_size);
+                values.resize(offset + chunk);
+                ReadBytes(values.data() + offset, chunk * sizeof(T));
+            }
+        } else {
+            values.reserve(std::min(size, chunk_size));
+            for (size_t i = 0; i < size; ++i) {
+                values.emplace_back();
+                Read(values.back());
+            }
+        }
+    }
+
+    template <typename T>
+    void Read(SharedPtr<T>& ptr) {
+        uint64_t id = ReadId();
+        if (id == 0) {
+            ptr.Reset();
+        } else if (id <= objects_.size()) {
+            const Entry& entry = Lookup<SharedPtr<T>>(id);
+            ptr.Reset();
+            ptr.block_ = entry.block;
+            ptr.ptr_ = static_cast<T*>(entry.obj);
+            ptr.block_->IncStr();
+        } else {
+            ptr = MakeShared<T>();
+            ptr.block_->IncStr();
+            objects_.push_back({ptr.Get(), ptr.block_, &ReleaseShared, TypeTag<SharedPtr<T>>()});
+            pending_.push_back({ptr.Get(), &ReadBody<T>});
+        }
+        if (!reading_pending_) {
+            ReadPending();
+        }
+    }
+    template <typename T>
+    void Read(IntrusivePtr<T>& ptr) {
+        uint64_t id = ReadId();
+        if (id == 0) {
+            ptr.Reset();
+        } else if (id <= objects_.size()) {
+            ptr.Reset(static_cast<T*>(Lookup<IntrusivePtr<T>>(id).obj));
+        } else {
+            ptr = MakeIntrusive<T>();
+            ptr->IncRef();
+            objects_.push_back(
+                {ptr.Get(), nullptr, &ReleaseIntrusive<T>, TypeTag<IntrusivePtr<T>>()});
+            pending_.push_back({ptr.Get(), &ReadBody<T>});
+        }
+        if (!reading_pending_) {
+            ReadPending();
+        }
+    }
+
+private:
+    static constexpr size_t kReadChunk = 64 * 1024;
+
+    struct Entry {
+        void* obj;
+        ControlBlockBase* block;
+        void (*release)(void* obj, ControlBlockBase* block);
+        // Pointer type the object was loaded as, see `TypeTag`
+        const void* type;
+    };
+
+    // Object whose body is still to be read, kept alive by its entry in `objects_`
+    struct Pending {
+        void* obj;
+        void (*read)(InputArchive& archive, void* obj);
+    };
+
+    template <typename T>
+    static void ReadBody(InputArchive& archive, void* obj) {
+        archive.Read(*static_cast<T*>(obj));
+    }
+
+    // Reads queued bodies in the order `OutputArchive` wrote them
+    void ReadPending() {
+        reading_pending_ = true;
+        try {
+            while (!pending_.empty()) {
+                Pending next = pending_.front();
+                pending_.pop_front();
+                next.read(*this, next.obj);
+            }
+        } catch (...) {
+            reading_pending_ = false;
+            pending_.clear();
+            throw;
+        }
+        reading_pending_ = false;
+    }
+
+    // Distinct address per type, works without RTTI
+    template <typename Ptr>
+    static const void* TypeTag() {
+        static const char tag = 0;
+        return &tag;
+    }
+
+    template <typename Ptr>
+    const Entry& Lookup(uint64_t id) const {
+        const Entry& entry = objects_[id - 1];
+        if (entry.type != TypeTag<Ptr>()) {
+            throw ArchiveError{};
+        }
+        return entry;
+    }
+
+    static void ReleaseShared(void*, ControlBlockBase* block) {
+        block->ReleaseStrong();
+    }
+    template <typename T>
+    static void ReleaseIntrusive(void* obj, ControlBlockBase*) {
+        static_cast<T*>(obj)->DecRef();
+    }
+
+    size_t ReadSize(size_t max_size) {
+        uint64_t size;
+        Read(size);
+        if (size > max_size) {
+            throw ArchiveError{};
+        }
+        return static_cast<size_t>(size);
+    }
+    // Ids come in order of first occurrence, an unseen one must be the next
+    uint64_t ReadId() {
+        uint64_t id;
+        Read(id);
+        if (id > objects_.size() + 1) {
+            throw ArchiveError{};
+        }
+        return id;
+    }
+
+    std::istream& in_;
+    std::vector<Entry> objects_;
+    std::deque<Pending> pending_;
+    bool reading_pending_ = false;
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 64-bit weak reference into a `SlotMap`: slot index plus the generation of the slot
+// at the time of insertion. Once the object is erased the slot's generation moves on
+// and the handle stops resolving, like an expired `WeakPtr`.
+struct SlotHandle {
+    uint32_t index = 0;
+    // Odd while the slot is occupied, so a default handle never resolves
+    uint32_t generation = 0;
+};
+
+inline bool operator==(SlotHandle left, SlotHandle right) {
+    return left.index == right.index && left.generation == right.generation;
+}
+
+inline bool operator!=(SlotHandle left, SlotHandle right) {
+    return !(left == right);
+}
+
+template <typename T>
+class SlotMap;
+
+// Keeps an object of a `SlotMap` alive while held, like a `SharedPtr` from `WeakPtr::Lock()`.
+// Erasing a pinned object only invalidates its handles, it is destroyed with the last guard.
+// The map itself must outlive its guards.
+template <typename T>
+class SlotGuard {
+    friend class SlotMap<T>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SlotGuard() : map_(nullptr), index_(0) {
+    }
+
+    SlotGuard(const SlotGuard& other) : map_(other.map_), index_(other.index_) {
+        if (map_ != nullptr) {
+            map_->Pin(index_);
+        }
+    }
+    SlotGuard(SlotGuard&& other) : map_(std::exchange(other.map_, nullptr)), index_(other.index_) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    SlotGuard& operator=(SlotGuard other) {
+        Swap(other);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~SlotGuard() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (map_ != nullptr) {
+            map_->Unpin(index_);
+            map_ = nullptr;
+        }
+    }
+    void Swap(SlotGuard& other) {
+        std::swap(map_, other.map_);
+        std::swap(index_, other.index_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Objects may move inside the map, so the address is looked up on every access.
+    T* Get() const {
+        if (map_ == nullptr) {
+            return nullptr;
+        }
+        return &map_->values_[map_->slot_to_dense_[index_]];
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    explicit operator bool() const {
+        return map_ != nullptr;
+    }
+
+private:
+    SlotGuard(SlotMap<T>* map, uint32_t index) : map_(map), index_(index) {
+        map_->Pin(index_);
+    }
+
+    SlotMap<T>* map_;
+    uint32_t index_;
+};
+
+// Objects stored contiguously (swap-remove on erase) and addressed by generational handles.
+// Per-slot data is kept in separate arrays, lookups touch only the generation and
+// the dense index of one slot. Not thread-safe.
+template <typename T>
+class SlotMap {
+    friend class SlotGuard<T>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SlotMap() = default;
+
+    // Guards point back to the map
+    SlotMap(const SlotMap& other) = delete;
+    SlotMap& operator=(const SlotMap& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // If the object's constructor (or an allocation) throws, the map is left unchanged.
+    template <typename... Args>
+    SlotHandle Emplace(Args&&... args) {
+        // Room is made up front, so nothing throws once the object is built
+        ReserveNext(dense_to_slot_);
+        if (free_head_ == kNone) {
+            ReserveNext(generations_);
+            ReserveNext(slot_to_dense_);
+            ReserveNext(pins_);
+        }
+        values_.emplace_back(std::forward<Args>(args)...);
+        uint32_t index;
+        if (free_head_ != kNone) {
+            index = free_head_;
+            free_head_ = slot_to_dense_[index];
+        } else {
+            index = static_cast<uint32_t>(generations_.size());
+            generations_.push_back(0);
+            slot_to_dense_.push_back(kNone);
+            pins_.push_back(0);
+        }
+        dense_to_slot_.push_back(index);
+        slot_to_dense_[index] = static_cast<uint32_t>(values_.size() - 1);
+        ++generations_[index];
+        return SlotHandle{index, generations_[index]};
+    }
+    SlotHandle Insert(const T& value) {
+        return Emplace(value);
+    }
+    SlotHandle Insert(T&& value) {
+        return Emplace(std::move(value));
+    }
+
+    // Returns false if the handle is stale. Pinned objects live on until unpinned.
+    bool Erase(SlotHandle handle) {
+        if (!Contains(handle)) {
+            return false;
+        }
+        ++generations_[handle.index];
+        if (pins_[handle.index] == 0) {
+            Remove(handle.index);
+        }
+        return true;
+    }
+
+    void Clear() {
+        for (uint32_t index : std::vector<uint32_t>(dense_to_slot_)) {
+            if (generations_[index] % 2 == 1) {
+                Erase(SlotHandle{index, generations_[index]});
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Lookup
+
+    bool Contains(SlotHandle handle) const {
+        return handle.index < generations_.size() &&
+               generations_[handle.index] == handle.generation && handle.generation % 2 == 1;
+    }
+    // O(1), nullptr for a stale handle. The pointer is invalidated by the next insert or erase.
+    T* Get(SlotHandle handle) {
+        if (!Contains(handle)) {
+            return nullptr;
+        }
+        return &values_[slot_to_dense_[handle.index]];
+    }
+    const T* Get(SlotHandle handle) const {
+        if (!Contains(handle)) {
+            return nullptr;
+        }
+        return &values_[slot_to_dense_[handle.index]];
+    }
+    // Guard holding the object, empty for a stale handle.
+    SlotGuard<T> Lock(SlotHandle handle) {
+        if (!Contains(handle)) {
+            return SlotGuard<T>();
+        }
+        return SlotGuard<T>(this, handle.index);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Objects still pinned after `Erase` are included
+    size_t Size() const {
+        return values_.size();
+    }
+    bool Empty() const {
+        return values_.empty();
+    }
+
+    // Dense iteration over all stored objects, in no particular order. Objects erased while
+    // pinned by a `SlotGuard` are still stored and are visited too, as in `Size()`.
+    T* begin() {
+        return values_.data();
+    }
+    T* end() {
+        return values_.data() + values_.size();
+    }
+    const T* begin() const {
+        return values_.data();
+    }
+    const T* end() const {
+        return values_.data() + values_.size();
+    }
+
+private:
+    static constexpr uint32_t kNone = 0xFFFFFFFF;
+
+    // Grows geometrically, as `push_back` would
+    static void ReserveNext(std::vector<uint32_t>& values) {
+        if (values.size() == values.capacity()) {
+            values.reserve(values.empty() ? 8 : 2 * values.capacity());
+        }
+    }
+
+    void Pin(uint32_t index) {
+        ++pins_[index];
+    }
+    void Unpin(uint32_t index) {
+        if (--pins_[index] == 0 && generations_[index] % 2 == 0) {
+            Remove(index);
+        }
+    }
+
+    // Destroys the object of an erased slot and frees the slot
+    void Remove(uint32_t index) {
+        uint32_t dense = slot_to_dense_[index];
+        uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+        if (dense != last) {
+            values_[dense] = std::move(values_[last]);
+            dense_to_slot_[dense] = dense_to_slot_[last];
+            slot_to_dense_[dense_to_slot_[dense]] = dense;
+        }
+        values_.pop_back();
+        dense_to_slot_.pop_back();
+        slot_to_dense_[index] = free_head_;
+        free_head_ = index;
+    }
+
+    // Dense arrays
+    std::vector<T> values_;
+    std::vector<uint32_t> dense_to_slot_;
+    // Per-slot arrays, a free slot keeps the next free slot in `slot_to_dense_`
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> slot_to_dense_;
+    std::vector<uint32_t> pins_;
+    uint32_t free_head_ = kNone;
+};
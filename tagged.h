@@ -0,0 +1,272 @@
+#pragma once
+
+#include "Unique/compressed_pair.h"
+#include "Unique/unique.h"
+#include "intrusive.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <utility>
+
+// Smart pointers that keep a few bits of user data in the pointer word itself.
+// `kLow` borrows the low bits that are always zero due to `alignof(T)`,
+// `kHigh` borrows the top bits of a canonical x86-64/AArch64 address (48-bit user space).
+enum class TagPlacement { kLow, kHigh };
+
+template <typename T, size_t Bits, TagPlacement Placement>
+struct TagTraits {
+    static_assert(Bits > 0 && Bits <= 16, "At most 16 tag bits are available");
+
+    static constexpr uintptr_t kTagMask = (uintptr_t{1} << Bits) - 1;
+    static constexpr size_t kShift = Placement == TagPlacement::kLow ? 0 : 64 - Bits;
+
+    // `T` may be incomplete where the pointer is declared, so alignment is checked on use.
+    static uintptr_t Pack(T* ptr, uintptr_t tag) {
+        static_assert(Placement == TagPlacement::kHigh || (size_t{1} << Bits) <= alignof(T),
+                      "Alignment of T leaves too few low bits for the tag");
+        static_assert(Placement == TagPlacement::kLow || sizeof(uintptr_t) == 8,
+                      "High tag bits need 64-bit pointers");
+        uintptr_t word = reinterpret_cast<uintptr_t>(ptr);
+        if constexpr (Placement == TagPlacement::kHigh) {
+            word &= ~(kTagMask << kShift);
+        }
+        return word | ((tag & kTagMask) << kShift);
+    }
+    static T* Pointer(uintptr_t word) {
+        if constexpr (Placement == TagPlacement::kLow) {
+            return reinterpret_cast<T*>(word & ~kTagMask);
+        } else {
+            // Restore the canonical form by sign-extending the remaining address bits
+            return reinterpret_cast<T*>(static_cast<intptr_t>(word << Bits) >> Bits);
+        }
+    }
+    static uintptr_t Tag(uintptr_t word) {
+        return (word >> kShift) & kTagMask;
+    }
+};
+
+// `UniquePtr` with a tag, a stateless deleter still adds no size
+template <typename T, typename Deleter = Slug<T>, size_t Bits = 1,
+          TagPlacement Placement = TagPlacement::kLow>
+class TaggedUniquePtr {
+    using Traits = TagTraits<T, Bits, Placement>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit TaggedUniquePtr(T* ptr = nullptr, uintptr_t tag = 0) {
+        object_.GetFirst() = Traits::Pack(ptr, tag);
+    }
+    TaggedUniquePtr(T* ptr, uintptr_t tag, Deleter deleter) {
+        object_.GetFirst() = Traits::Pack(ptr, tag);
+        object_.GetSecond() = std::move(deleter);
+    }
+
+    TaggedUniquePtr(const TaggedUniquePtr& other) = delete;
+    TaggedUniquePtr& operator=(const TaggedUniquePtr& other) = delete;
+
+    // The tag moves together with the pointer
+    TaggedUniquePtr(TaggedUniquePtr&& other) noexcept {
+        object_.GetFirst() = std::exchange(other.object_.GetFirst(), 0);
+        object_.GetSecond() = std::move(other.GetDeleter());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    TaggedUniquePtr& operator=(TaggedUniquePtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        object_.GetSecond()(Get());
+        object_.GetFirst() = std::exchange(other.object_.GetFirst(), 0);
+        object_.GetSecond() = std::move(other.GetDeleter());
+        return *this;
+    }
+    TaggedUniquePtr& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~TaggedUniquePtr() {
+        object_.GetSecond()(Get());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Gives up ownership, the tag is kept
+    T* Release() {
+        T* obj = Get();
+        object_.GetFirst() = Traits::Pack(nullptr, GetTag());
+        return obj;
+    }
+    // Replaces the pointee, the tag is kept
+    void Reset(T* ptr = nullptr) {
+        T* old = Get();
+        object_.GetFirst() = Traits::Pack(ptr, GetTag());
+        object_.GetSecond()(old);
+    }
+    void Swap(TaggedUniquePtr& other) {
+        std::swap(object_.GetFirst(), other.object_.GetFirst());
+        std::swap(object_.GetSecond(), other.object_.GetSecond());
+    }
+    void SetTag(uintptr_t tag) {
+        object_.GetFirst() = Traits::Pack(Get(), tag);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return Traits::Pointer(object_.GetFirst());
+    }
+    uintptr_t GetTag() const {
+        return Traits::Tag(object_.GetFirst());
+    }
+    Deleter& GetDeleter() {
+        return object_.GetSecond();
+    }
+    const Deleter& GetDeleter() const {
+        return object_.GetSecond();
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+
+private:
+    CompressedPair<uintptr_t, Deleter> object_;
+};
+
+// `IntrusivePtr` with a tag
+template <typename T, size_t Bits = 1, TagPlacement Placement = TagPlacement::kLow>
+class TaggedIntrusivePtr {
+    using Traits = TagTraits<T, Bits, Placement>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    TaggedIntrusivePtr() : word_(0) {
+    }
+    TaggedIntrusivePtr(std::nullptr_t) : TaggedIntrusivePtr() {
+    }
+    explicit TaggedIntrusivePtr(T* ptr, uintptr_t tag = 0) : word_(Traits::Pack(ptr, tag)) {
+        if (ptr) {
+            ptr->IncRef();
+        }
+    }
+    TaggedIntrusivePtr(const IntrusivePtr<T>& other, uintptr_t tag = 0)
+        : TaggedIntrusivePtr(other.Get(), tag) {
+    }
+
+    TaggedIntrusivePtr(const TaggedIntrusivePtr& other) : word_(other.word_) {
+        if (T* ptr = Get()) {
+            ptr->IncRef();
+        }
+    }
+    TaggedIntrusivePtr(TaggedIntrusivePtr&& other) : word_(std::exchange(other.word_, 0)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    TaggedIntrusivePtr& operator=(const TaggedIntrusivePtr& other) {
+        if (word_ == other.word_) {
+            return *this;
+        }
+        if (T* ptr = other.Get()) {
+            ptr->IncRef();
+        }
+        Reset();
+        word_ = other.word_;
+        return *this;
+    }
+    TaggedIntrusivePtr& operator=(TaggedIntrusivePtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        word_ = std::exchange(other.word_, 0);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~TaggedIntrusivePtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Drops the pointee, the tag is kept
+    void Reset() {
+        if (T* ptr = Get()) {
+            word_ = Traits::Pack(nullptr, GetTag());
+            ptr->DecRef();
+        }
+    }
+    // Replaces the pointee, the tag is kept
+    void Reset(T* ptr) {
+        if (ptr) {
+            ptr->IncRef();
+        }
+        uintptr_t tag = GetTag();
+        Reset();
+        word_ = Traits::Pack(ptr, tag);
+    }
+    void Swap(TaggedIntrusivePtr& other) {
+        std::swap(word_, other.word_);
+    }
+    void SetTag(uintptr_t tag) {
+        word_ = Traits::Pack(Get(), tag);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return Traits::Pointer(word_);
+    }
+    uintptr_t GetTag() const {
+        return Traits::Tag(word_);
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    size_t UseCount() const {
+        if (T* ptr = Get()) {
+            return ptr->RefCount();
+        }
+        return 0;
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+
+    // Owning pointer without the tag
+    IntrusivePtr<T> ToIntrusive() const {
+        return IntrusivePtr<T>(Get());
+    }
+
+private:
+    uintptr_t word_;
+};
+
+static_assert(sizeof(TaggedUniquePtr<int>) == sizeof(void*));
+static_assert(sizeof(TaggedIntrusivePtr<SimpleRefCounted<int>>) == sizeof(void*));